@@ -48,22 +48,43 @@
 
 #include <string>
 #include <vector>
+#include <boost/atomic.hpp>
+#include <boost/cstdint.hpp>
 #include <boost/chrono.hpp>
+#include <boost/function.hpp>
 #include <boost/thread.hpp>
 
 // forward declarations
 struct AVFormatContext;
 struct AVCodecContext;
 struct SwsContext;
+struct SwrContext;
 struct AVFrame;
 struct AVPacket;
 struct AVRational;
 
 namespace _2RealFFmpegWrapper
 {
+	struct VideoFrame;
+	struct QueuedPacket;
+	class ScalerCache;
+	class SeekIndex;
+	class FrameCache;
+	class AudioFifo;
+	class PlayerGroup;
+	class MappedFile;
+	struct PlayerCounters;
+	class PacketPool;
+	template <typename T> class BoundedQueue;
+
 	enum {eNoLoop, eLoop, eLoopBidi};
-	enum {eOpened, ePlaying, ePaused, eStopped, eEof, eError};
+	enum {eOpened, ePlaying, ePaused, eStopped, eEof, eError, eOpening};
 	enum {eForward=1, eBackward=-1};
+	enum {eOutputRGB24, eOutputNative, eOutputBGRA, eOutputRGBA, eOutputGray8, eOutputNV12};	// eOutputNative hands out the decoder's planes (e.g. yuv420p) as they are
+	enum {eScaleFastBilinear, eScaleBilinear, eScaleBicubic, eScalePoint, eScaleArea};
+	enum {eAudioNative, eAudioS16, eAudioFloat};	// interleaved sample format handed out by readAudio, eAudioNative keeps the decoder's format
+	enum {eReadAheadNormal, eReadAheadSequential, eReadAheadRandom};	// access pattern hint for memory mapped files
+	enum {eThreadAuto=0, eThreadFrame=1, eThreadSlice=2, eThreadFrameAndSlice=3};	// decoder threading, frame threading adds one frame of latency per thread
 	enum {eMajorVersion=0, eMinorVersion=1, ePatchVersion=0}; 
 
 	typedef struct AudioData
@@ -77,6 +98,24 @@ namespace _2RealFFmpegWrapper
 		unsigned char*			m_pData;
 	} AudioData;
 
+	// reference counted handle to a pooled frame buffer, the buffer isn't reused by the player as long as a handle to it exists
+	class FrameHandle
+	{
+	public:
+		FrameHandle();
+		explicit FrameHandle(VideoFrame* pFrame);
+		FrameHandle(const FrameHandle& other);
+		~FrameHandle();
+		FrameHandle&	operator=(const FrameHandle& other);
+		void			reset();
+		bool			isValid() const;
+		unsigned char*	getData() const;
+		long			getFrameNumber() const;
+
+	private:
+		VideoFrame*		m_pFrame;
+	};
+
 	typedef struct VideoData
 	{
 		int						m_iWidth;
@@ -84,7 +123,11 @@ namespace _2RealFFmpegWrapper
 		int						m_iChannels;
 		long					m_lPts;
 		long					m_lDts;
-		unsigned char*			m_pData;
+		unsigned char*			m_pData;		// first plane, the whole picture for packed formats like rgb24
+		unsigned char*			m_pPlanes[4];
+		int						m_iLinesizes[4];
+		int						m_iPixelFormat;	// ffmpeg PixelFormat of the planes
+		FrameHandle				m_Frame;		// keeps m_pData valid as long as a copy of this VideoData is held
 	} VideoData;
 
 	typedef struct AVData
@@ -93,6 +136,56 @@ namespace _2RealFFmpegWrapper
 		AudioData				m_AudioData;
 	} AVData;
 
+	// time spent on one kind of work since open
+	typedef struct TimingStats
+	{
+		long					m_lCount;
+		double					m_dTotalInMs;
+		double					m_dMaxInMs;
+		double					m_dRecentInMs;		// moving average over roughly the last 16 calls
+	} TimingStats;
+
+	// snapshot of a player's counters, see getStats
+	typedef struct PlayerStats
+	{
+		long					m_lPacketsDemuxed;
+		boost::int64_t			m_lBytesDemuxed;		// payload of the demuxed packets
+		long					m_lFramesDecoded;		// video frames out of the decoder
+		long					m_lFramesDropped;		// decoded, but skipped as they were late
+		long					m_lFramesPresented;
+		long					m_lPacketShellAllocations;		// packet shells allocated, stays flat during steady playback
+		long					m_lPacketPayloadAllocations;	// packet payloads allocated, keeps growing with demuxers that allocate every packet
+		long					m_lFrameCacheHits;
+		long					m_lFrameCacheMisses;
+		long					m_lAudioUnderruns;
+		long					m_lAudioOverruns;
+		double					m_dAudioVideoDrift;
+		double					m_dMaxAudioVideoDrift;
+		int						m_iVideoPackets;		// queued right now
+		int						m_iAudioPackets;
+		int						m_iReadyFrames;
+		int						m_iAudioFrames;			// sample frames buffered for readAudio
+		TimingStats				m_Demux;				// av_read_frame
+		TimingStats				m_VideoDecode;
+		TimingStats				m_AudioDecode;
+		TimingStats				m_Scale;				// sws_scale or the own kernels into the output format
+		TimingStats				m_Copy;					// plane copies if the output is the decoder's format
+	} PlayerStats;
+
+	// media from somewhere else than a file, e.g. an asset archive, read and seek work like fread and fseek
+	// the calls come from one player thread at a time, the source stays owned by the application
+	class InputSource
+	{
+	public:
+		virtual ~InputSource() {}
+		virtual int				read(unsigned char* pBuffer, int iSize) = 0;		// bytes read, 0 at the end, negative on errors
+		virtual boost::int64_t	seek(boost::int64_t lOffset, int iWhence) = 0;		// SEEK_SET, SEEK_CUR or SEEK_END, the new position or -1
+		virtual boost::int64_t	getSize() { return -1; }							// -1 if unknown
+	};
+
+	class FFmpegWrapper;
+	typedef boost::function<void (FFmpegWrapper* pPlayer, bool bOpened)> OpenCallback;
+
 	class FFmpegWrapper
 	{
 	public:
@@ -102,6 +195,11 @@ namespace _2RealFFmpegWrapper
 
 		bool init();
 		bool open(std::string strFileName);
+		bool open(const unsigned char* pData, boost::int64_t lSize, std::string strName = "");	// not copied, has to stay valid until close, the name's extension helps to detect the format
+		bool open(InputSource* pSource, std::string strName = "");		// has to stay valid until close, no seek index is built as that would need a second reader
+		void openAsync(std::string strFileName, OpenCallback callback = OpenCallback());	// returns right away, getState is eOpening until the open thread is done and calls the callback, just play, pause, stop, close and getState may be called meanwhile
+		bool isOpening();
+		bool waitForOpen();		// blocks until an openAsync is done, true if the file is open
 		void close();
 		void play();
 		void stop();
@@ -112,6 +210,9 @@ namespace _2RealFFmpegWrapper
 		AudioData&		getAudioData();
 		void			setFramePosition(long lTargetFrameNumber);
 		void			setTimePositionInMs(double dTargetTimeInMs);
+		bool			preroll(long lFrameNumber, int iFrames = 0);	// pauses, seeks and decodes up to iFrames (0 .. frame queue depth) in the background, play() then just flips the state
+		bool			prerollTime(double dTimeInMs, int iFrames = 0);
+		bool			isPrerolled();				// the frames of the last preroll are buffered, false again after play
 		void		    setPosition(float fPos);	// between 0 .. 1 for begin and end of stream
 		unsigned int	getWidth();
 		unsigned int	getHeight();
@@ -133,6 +234,69 @@ namespace _2RealFFmpegWrapper
 		std::string		getFileName();
 		void			setLoopMode(int iMode);
 		void			setSpeed(float fSpeed);		// multiplier, no negative values, direction is setDirection
+		void			setRealtimeEnabled(bool bEnabled);	// off presents every frame as soon as it is decoded, e.g. for benchmarks or offline processing, default on
+		bool			isRealtimeEnabled();
+		void			setFrameQueueDepth(int iDepth);	// number of frames decoded ahead by the player thread, applied on next open
+		int				getFrameQueueDepth();
+		void			setOutputFormat(int iFormat, int iWidth = 0, int iHeight = 0, int iScaler = eScaleBicubic);	// size 0 keeps the source size, takes effect with the next decoded frame
+		int				getOutputFormat();
+		int				getOutputScaler();
+		void			setOutputRowAlignment(int iBytes);	// rows start at multiples of iBytes, a power of two up to 256, e.g. 4 for gl textures, 0 packs them tightly
+		int				getOutputRowAlignment();
+		unsigned int	getSourceWidth();
+		unsigned int	getSourceHeight();
+		void			setPacketQueueDepth(int iDepth);	// packets buffered per stream between demuxer and decoders, applied on next play
+		int				getPacketQueueDepth();
+		void			setBackwardCacheSize(int iFrames);	// frames decoded per step when playing backwards, two steps are kept in memory, applied on next open
+		int				getBackwardCacheSize();
+		void			setFrameCacheSize(int iMegaBytes);	// keeps decoded frames for scrubbing and loops, 0 disables the cache, applied on next open
+		int				getFrameCacheSize();
+		void			setFileMappingEnabled(bool bEnabled);	// local files are memory mapped and read without syscalls, default on for 64 bit builds, never for network shares, applied on next open
+		bool			isFileMappingEnabled();
+		bool			isFileMapped();				// the opened file is read through a mapping
+		void			setReadAhead(int iHint, int iWindowInKB = 4096);	// how the mapped pages are accessed, the window is prefetched in front of the demuxer, 0 .. none
+		int				getReadAheadHint();
+		int				getReadAheadWindow();
+		void			setProbeSize(int iBytes);	// read to detect the format, also limits the stream analysis, 0 .. ffmpeg's default, applied on next open
+		int				getProbeSize();
+		void			setAnalyzeDuration(int iMilliSeconds);	// of the streams analysed for codec parameters and frame rate, 0 .. ffmpeg's default, applied on next open
+		int				getAnalyzeDuration();
+		void			setFastStartEnabled(bool bEnabled);	// remembers the stream info of opened files (in the seek index cache directory too) and skips the analysis when they are opened again, default off
+		bool			isFastStartEnabled();
+		bool			isFastStarted();			// the opened file's stream info came from the cache
+		void			setSeekIndexEnabled(bool bEnabled);	// build a keyframe index on a background thread for frame accurate seeking, applied on next open, off by default, just for seekable local files and memory
+		bool			isSeekIndexEnabled();
+		bool			isSeekIndexComplete();
+		static void		setSeekIndexCacheDirectory(const std::string& strDirectory);	// finished indices and fast start stream info are stored there and reused when the file is opened again, empty disables the cache
+		static std::string	getSeekIndexCacheDirectory();
+		void			setDecoderThreads(int iThreadCount, int iThreadType = eThreadAuto);	// count 0 uses the global default, applied on next open
+		int				getDecoderThreads();		// threads granted to the opened video decoder
+		int				getDecoderThreadType();
+		static void		setDefaultDecoderThreads(int iThreadCount, int iThreadType = eThreadAuto);	// count 0 means as many as the core budget allows
+		static void		setDecoderCoreBudget(int iCores);	// decoder threads shared by all players, 0 uses the number of cores
+		static int		getDecoderCoreBudget();
+		static int		getDecoderThreadsInUse();
+		int				readAudio(void* pBuffer, int iFrames);	// realtime safe pull of interleaved sample frames for sound card callbacks, missing frames are silence, returns the frames read
+		int				getAudioBytesPerFrame();	// channels times bytes per sample of the output format
+		void			setAudioOutputFormat(int iFormat, int iSampleRate = 0, int iChannels = 0);	// 0 keeps the source rate and channels, applied on next open
+		int				getAudioOutputFormat();
+		int				getAudioOutputSampleRate();	// of the opened file, as handed out by readAudio
+		int				getAudioOutputChannels();
+		void			setAudioSyncEnabled(bool bEnabled);	// video follows the audio consumed by readAudio while playing forward at normal speed, default on
+		bool			isAudioSyncEnabled();
+		bool			isAudioSyncActive();		// the audio clock drove the last update, otherwise the wall clock does
+		void			setAudioLatency(double dLatencyInMs);	// time between readAudio and the samples being heard, e.g. the sound card buffer
+		double			getAudioLatency();
+		double			getAudioVideoDrift();		// in ms at the last update, positive if the video is ahead of the audio
+		double			getMaxAudioVideoDrift();	// largest absolute drift since open, frame quantization included
+		void			setAudioBufferSize(int iMilliSeconds);	// audio decoded ahead for readAudio, applied on next open
+		int				getAudioBufferSize();
+		long			getAudioUnderruns();		// sample frames readAudio had to fill with silence
+		long			getAudioOverruns();			// sample frames dropped because nobody read them in time
+		void			setVisible(bool bVisible);	// hidden players in a PlayerGroup don't decode, default visible
+		bool			isVisible();
+		PlayerGroup*	getPlayerGroup();
+		PlayerStats		getStats();					// counters since open, can be called from any thread, holds the player's mutex just for the cache and fifo counters
 		bool			hasVideo();
 		bool			hasAudio();
 		bool			isImage();
@@ -140,43 +304,104 @@ namespace _2RealFFmpegWrapper
 		void			dumpFFmpegInfo();
 
 	private:
+		friend class PlayerGroup;
+
+		void			initSettings();
 		void			initPropertyVariables();
 		bool			openVideoStream();
 		bool			openAudioStream();
 		bool			seekFrame(long lFrameNumber);
 		bool			seekTime(double dTimeInMs);
+		void			threadedDemuxer();
+		void			threadedVideoDecoder();
+		void			threadedAudioDecoder();
+		void			startPlayerThreads();
+		void			stopPlayerThreads();
+		void			flushPacketQueues();
+		void			freeQueuedPacket(QueuedPacket& packet);
+		bool			pushPacket(AVPacket* pAVPacket, int iSerial);
+		bool			pushPacketCommand(int iCommand, int iSerial, long lTargetFrame, long lLastFrame);
+		bool			outputVideoFrame(int iSerial, long lMinFrameNumber, long lMaxFrameNumber, long& lLastFrameNumber, bool& bSegmentDone, std::vector<VideoFrame*>& segment);
+		bool			pushBackwardFrames(std::vector<VideoFrame*>& frames, bool bWait, bool bAll = false);
+		bool			allocateVideoFrames();
+		void			applySeekIndexInfo();
+		void			reserveDecoderThreads();
+		void			releaseDecoderThreads();
+		void			freeVideoFrames();
+		void			flushReadyFrames();
+		bool			presentNextFrame();
+		void			requestSeek(long lTargetFrameNumber, bool bUseCache = true);
+		void			presentFrame(VideoFrame* pFrame);
+		bool			handleEndOfStream(int iSerial, long& lBackwardTarget);
 		bool			decodeFrame();
-		bool			decodeVideoFrame(AVPacket* pAVPacket);
-		bool			decodeAudioFrame(AVPacket* pAVPacket);
+		VideoFrame*		convertVideoFrame(bool bBlocking);
+		void			getOutputSpec(int& iWidth, int& iHeight, int& iPixelFormat, int& iFlags, int& iRowAlignment);
+		bool			decodeVideoFrame(AVPacket* pAVPacket, bool bInSlot = false);
+		bool			acquireGroupSlot();
+		void			releaseGroupSlot();
+		bool			isDecodeActive();
+		double			getDecodeDeadline();
+		void			publishDecodeSchedule();
+		bool			decodeAudioFrame(AVPacket* pAVPacket, int iSerial = -1);
+		void			writeAudioFifo(int iSerial);
+		int				resampleAudioFrame();
+		void			anchorAudioClock(int iSerial);
+		bool			getAudioClock(double& dFrames);
+		void			updateAudioVideoDrift(double dAudioFrames);
+		double			calculateAudioTime(boost::int64_t lPts);
 		bool			decodeImage();
+		bool			openMappedFile(const std::string& strFileName);
+		bool			openFile(const std::string& strFileName);
+		bool			openInput(const std::string& strName, bool bCanIndex, bool bCanCache);
+		void			threadedOpen(std::string strFileName, OpenCallback callback);
+		static int		isOpenAborted(void* pOpaque);
+		void			startPlayback();
 		AVPacket*		fetchAVPacket();
 		void			retrieveFileInfo();
 		void			retrieveVideoInfo();
 		void			retrieveAudioInfo();
-		void			updateTimer();
 		double			getDeltaTime();
+		bool			presentScheduledFrame(double dFramesElapsed);
+		int				getFrameSkip();
+		bool			isKeyFramesOnly();
 		long			calculateFrameNumberFromTime(long lTime);
+		long			calculateFrameNumberFromPts(boost::int64_t lPts);
+		long			calculateFrameNumberFromPacket(AVPacket* pAVPacket);
+		boost::int64_t	calculateTimestampFromFrameNumber(int iStream, long lFrameNumber);
 		double			mod(double a, double b);
 		double			r2d(AVRational r);
+		int				getChannelCount(int iPixelFormat);
 
 		AVFormatContext*		m_pFormatContext;
 		AVCodecContext*			m_pVideoCodecContext;
 		AVCodecContext*			m_pAudioCodecContext;
-		SwsContext*				m_pSwScalingContext;
 		AVFrame*				m_pVideoFrame;
-		AVFrame*				m_pVideoFrameRGB;
 		AVFrame*				m_pAudioFrame;
 		AVData					m_AVData;
+		ScalerCache*			m_pScalerCache;
+		SeekIndex*				m_pSeekIndex;				// nullptr if disabled, seeking falls back to the demuxer then
+		FrameCache*				m_pFrameCache;				// nullptr if disabled
+		MappedFile*				m_pMappedFile;				// mapped file or memory passed to open, nullptr otherwise
+		InputSource*			m_pInputSource;				// source passed to open, not owned
+		void*					m_pIOContext;				// AVIOContext of m_pMappedFile or m_pInputSource for m_pFormatContext, that type can't be forward declared
+		PlayerGroup*			m_pGroup;					// schedules the video decoding if set, nullptr .. own decoder thread
+		AudioFifo*				m_pAudioFifo;				// decoded audio for readAudio, nullptr without audio
+		PlayerCounters*			m_pCounters;
+		PacketPool*				m_pPacketPool;				// recycles the packets of the demuxer thread
+		SwrContext*				m_pResampler;				// set up on first use if the output spec differs from the decoder's
+		std::vector<unsigned char>	m_ResampleBuffer;		// grows to the largest converted audio frame
+		BoundedQueue<VideoFrame*>*		m_pReadyFrames;			// decoded frames in presentation order, filled by the video decoder thread
+		BoundedQueue<QueuedPacket>*		m_pVideoPackets;		// demuxer thread -> video decoder thread
+		BoundedQueue<QueuedPacket>*		m_pAudioPackets;		// demuxer thread -> audio decoder thread
 
 		std::string				m_strFileName;	
 		std::string				m_strVideoCodecName;
 		std::string				m_strAudioCodecName;
-		unsigned char*			m_pVideoBuffer;
 		double					m_dCurrentTimeInMs;
 		double					m_dTargetTimeInMs;
 		double					m_dDurationInMs;
 		double					m_dFps;
-		float					m_fSpeedMultiplier;			// default 1.0, no negative values
+		boost::atomic<float>	m_fSpeedMultiplier;			// default 1.0, no negative values, read by the video decoder thread
 		unsigned long			m_lDurationInFrames;			// length in frames of file, or if cueIn and out are set frames between this range 
 		long					m_lCurrentFrameNumber;		// current framePosition ( if cue positions are set e.g. startCueFrame = 10, currentframe at absolute pos 10 is set to 0 (range between 10 and 500 --> current frame 0 .. 490)
 		unsigned long			m_lFramePosInPreLoadedFile;
@@ -189,12 +414,92 @@ namespace _2RealFFmpegWrapper
 		int						m_iDirection;
 		int						m_iLoopMode;					// 0 .. once, 1 .. loop normal, 2 .. loop bidirectional, default is loop
 		int						m_iState;
+		int						m_iFrameQueueDepth;
+		int						m_iOutputFormat;
+		int						m_iOutputWidth;
+		int						m_iOutputHeight;
+		int						m_iOutputScaler;
+		int						m_iOutputRowAlignment;
+		int						m_iPacketQueueDepth;
+		int						m_iBackwardCacheFrames;
+		int						m_iFrameCacheSize;			// in MB
+		int						m_iAudioBufferSize;			// in ms
+		int						m_iReadAheadHint;
+		int						m_iReadAheadWindow;			// in KB
+		int						m_iProbeSize;				// in bytes, 0 .. default
+		int						m_iAnalyzeDuration;			// in ms, 0 .. default
+		int						m_iAudioOutputFormat;
+		int						m_iAudioOutputSampleRate;	// requested, 0 .. source rate
+		int						m_iAudioOutputChannels;		// requested, 0 .. source channels
+		int						m_iAudioFifoFormat;			// AVSampleFormat, rate and channels the fifo holds for the opened file
+		int						m_iAudioFifoSampleRate;
+		int						m_iAudioFifoChannels;
+		int						m_iResampleInFormat;		// decoder output the resampler was set up for, -1 .. not set up
+		int						m_iResampleInSampleRate;
+		boost::uint64_t			m_lResampleInLayout;
+		bool					m_bResampleAudio;
+		bool					m_bAudioSync;
+		bool					m_bRealtime;
+		bool					m_bAudioSyncActive;
+		bool					m_bAudioClockValid;			// the anchor below is set, guarded by m_Mutex
+		unsigned int			m_iAudioClockPosition;		// audio fifo position of the anchor
+		double					m_dAudioClockTime;			// in s on the video timeline, of the sample at the anchor position
+		int						m_iAudioClockSerial;
+		unsigned int			m_iLastAudioReadCount;
+		boost::chrono::steady_clock::time_point m_LastAudioReadTime;
+		boost::atomic<long>		m_lAudioClockFrame;			// frame due by the audio clock, -1 .. no audio sync, written by update, read by the video decoder thread
+		boost::atomic<bool>		m_bVideoBehindAudio;		// the video decoder skips non reference frames to catch up
+		double					m_dAudioLatencyInMs;
+		double					m_dAudioVideoDrift;
+		double					m_dMaxAudioVideoDrift;
+		int						m_iDecoderThreads;			// requested, 0 .. global default
+		int						m_iDecoderThreadType;
+		int						m_iReservedThreads;			// taken from the global core budget while the video codec is open
+		int						m_iSerial;					// incremented with every seek, frames of an older serial are dropped
+		int						m_iPrerollFrames;			// decoded ahead while paused, 0 .. no preroll
+
+		// what the group schedules the decoders by, a copy of the presentation state taken by the main thread, so the
+		// decoder threads never see it halfway updated, guarded by m_Mutex
+		struct DecodeSchedule
+		{
+			bool	m_bActive;
+			bool	m_bFrameRequested;
+			int		m_iPrerollFrames;			// just while not playing
+			int		m_iFrameSkip;
+			double	m_dFramesDue;
+			double	m_dFramesPerSecond;
+		};
+		DecodeSchedule			m_DecodeSchedule;
+		long					m_lSeekTargetFrame;
 		bool					m_bIsInitialized;
+		bool					m_bSeekIndexEnabled;
+		bool					m_bVisible;
+		bool					m_bFileMapping;
+		bool					m_bFastStart;
+		bool					m_bFastStarted;
+		bool					m_bOpening;					// guarded by m_OpenMutex
+		boost::atomic<bool>		m_bAbortOpen;				// polled by ffmpeg's interrupt callback on the open thread
+		bool					m_bPlayAfterOpen;			// play was called while opening
+		bool					m_bSeekIndexApplied;		// duration and frame count were taken from the finished index
 		bool					m_bIsFileOpen;
-		bool					m_bIsThreadRunning;
-		boost::thread			m_PlayerThread;
+		boost::atomic<bool>		m_bIsThreadRunning;			// set by the main thread, the player group reads it without the player's mutex
+		bool					m_bSeekRequested;
+		bool					m_bSeekDeferred;			// a cached frame was shown while paused, the pipeline still is at the old position
+		bool					m_bFrameRequested;			// present the next decoded frame even if not playing (after open, seek)
+		bool					m_bEndOfStream;				// the video decoder output the last frame of a not looping stream
+		bool					m_bDemuxFinished;
+		boost::thread			m_DemuxThread;
+		boost::thread			m_VideoThread;
+		boost::thread			m_AudioThread;
+		boost::thread			m_OpenThread;
+		boost::mutex			m_OpenMutex;
 		boost::mutex			m_Mutex;
-	    boost::chrono::system_clock::time_point m_OldTime;
+		boost::condition_variable	m_PlayerCondition;
+		boost::chrono::steady_clock::time_point m_OldTime;
+		double					m_dFramesDue;				// presentation clock in frames not yet shown, advanced by speed and fps
+		long					m_lLastScheduledFrame;
+		long					m_lLastOutputFrame;			// video decoder thread, last frame converted for the ready queue
+		bool					m_bNewFrame;
 		bool					isFrameDecoded;
 	};
 };
\ No newline at end of file
@@ -0,0 +1,71 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+*/
+
+#pragma once
+
+#include <vector>
+#include <boost/thread.hpp>
+
+namespace _2RealFFmpegWrapper
+{
+	class FFmpegWrapper;
+
+	// a decode throttle for many players, not a thread pool: every player keeps its own demuxer and decoder threads,
+	// but the video decoder thread only decodes and converts while it holds one of a fixed number of slots, a free slot
+	// goes to the waiting player which runs out of frames first, so no more decodes run at once than there are cores
+	// paused and hidden players don't get one at all, so their threads just sleep until they are shown or played again
+	// players join before they are opened, so their codecs run single threaded and the slots spread the cores
+	// the threads and their stacks still grow with the number of players, see the known issues in the readme
+	class PlayerGroup
+	{
+	public:
+		PlayerGroup(int iSlots = 0);		// 0 uses the number of cores
+		~PlayerGroup();						// players still in the group stop decoding, play() continues them on their own
+
+		bool			add(FFmpegWrapper* pPlayer);		// just while the player isn't playing, returns false otherwise
+		bool			remove(FFmpegWrapper* pPlayer);		// same here, the player's destructor removes it as well
+		void			update();							// updates all players of the group
+		void			setSlotCount(int iSlots);
+		int				getSlotCount();
+		int				getBusySlots();
+		int				getPlayerCount();
+
+	private:
+		friend class FFmpegWrapper;
+		struct Waiter;
+
+		bool			acquireSlot(FFmpegWrapper* pPlayer);	// blocks until the player may decode, false once its threads stop
+		void			releaseSlot();
+		void			wake();				// a player changed its state, e.g. started playing or got visible
+		void			dispatch();			// with m_Mutex locked
+
+		std::vector<FFmpegWrapper*>		m_Players;
+		std::vector<Waiter*>			m_Waiting;
+		boost::mutex					m_Mutex;
+		int								m_iSlots;
+		int								m_iBusySlots;
+	};
+};
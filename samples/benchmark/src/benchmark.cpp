@@ -0,0 +1,263 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This benchmark uses _2RealFFmpegWrapper, and of course FFmpeg, it needs neither a window nor a sound card
+*/
+
+// decodes files as fast as the player can and reports throughput, frame intervals and where the time went as json
+//
+// usage: benchmark [--format rgb24,native,...] [--scaler bicubic] [--frames n] [--timeout s] [--json file] [files]
+//   --format	output formats to compare, each file is played once per format: rgb24, native, bgra, rgba, gray8, nv12
+//   --scaler	fastbilinear, bilinear, bicubic, point or area
+//   --frames	stop each run after that many frames, 0 plays the whole file
+//   --timeout	seconds per run
+//   --json		file to write the results to, stdout otherwise
+//   the files default to data/morph.avi, so run it from bin like the samples
+
+#include "_2RealFFmpegWrapper.h"
+#include "benchmarkUtils.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+using namespace _2RealFFmpegWrapper;
+
+struct BenchmarkRun
+{
+	std::string				m_strFile;
+	std::string				m_strFormat;
+	std::string				m_strCodec;
+	bool					m_bOpened;
+	bool					m_bTimedOut;
+	int						m_iWidth;
+	int						m_iHeight;
+	long					m_lFrames;
+	double					m_dOpenMs;
+	double					m_dFirstFrameMs;	// from play until the first frame was handed out
+	double					m_dElapsedMs;		// from play until the last frame
+	std::vector<double>		m_Intervals;		// between frames handed out, in ms
+	PlayerStats				m_Stats;
+};
+
+static void writeTiming(std::ostream& out, const char* strName, const TimingStats& timing, bool bLast = false)
+{
+	out << "\t\t\t\t\"" << strName << "\": {\"count\": " << timing.m_lCount << ", \"total\": " << timing.m_dTotalInMs
+		<< ", \"average\": " << ((timing.m_lCount > 0) ? timing.m_dTotalInMs / timing.m_lCount : 0)
+		<< ", \"recent\": " << timing.m_dRecentInMs << ", \"max\": " << timing.m_dMaxInMs << "}" << (bLast ? "\n" : ",\n");
+}
+
+static void writeJson(std::ostream& out, const std::vector<BenchmarkRun>& runs)
+{
+	out << "{\n\t\"version\": \"" << eMajorVersion << "." << eMinorVersion << "." << ePatchVersion << "\",\n\t\"runs\": [\n";
+	for(size_t i=0; i<runs.size(); i++)
+	{
+		const BenchmarkRun& run = runs[i];
+		std::vector<double> sorted = run.m_Intervals;
+		std::sort(sorted.begin(), sorted.end());
+		double dSeconds = run.m_dElapsedMs / 1000.0;
+
+		out << "\t\t{\n";
+		out << "\t\t\t\"file\": \"" << escapeJson(run.m_strFile) << "\",\n";
+		out << "\t\t\t\"format\": \"" << run.m_strFormat << "\",\n";
+		out << "\t\t\t\"opened\": " << (run.m_bOpened ? "true" : "false") << ",\n";
+		out << "\t\t\t\"codec\": \"" << escapeJson(run.m_strCodec) << "\",\n";
+		out << "\t\t\t\"width\": " << run.m_iWidth << ",\n";
+		out << "\t\t\t\"height\": " << run.m_iHeight << ",\n";
+		out << "\t\t\t\"timed_out\": " << (run.m_bTimedOut ? "true" : "false") << ",\n";
+		out << "\t\t\t\"frames\": " << run.m_lFrames << ",\n";
+		out << "\t\t\t\"fps\": " << ((dSeconds > 0) ? run.m_lFrames / dSeconds : 0) << ",\n";
+		out << "\t\t\t\"open_ms\": " << run.m_dOpenMs << ",\n";
+		out << "\t\t\t\"first_frame_ms\": " << run.m_dFirstFrameMs << ",\n";
+		out << "\t\t\t\"elapsed_ms\": " << run.m_dElapsedMs << ",\n";
+		out << "\t\t\t\"frame_interval_ms\": {\"p50\": " << getPercentile(sorted, 50) << ", \"p90\": " << getPercentile(sorted, 90)
+			<< ", \"p99\": " << getPercentile(sorted, 99) << ", \"max\": " << (sorted.empty() ? 0 : sorted.back()) << "},\n";
+		out << "\t\t\t\"counters\": {\"packets\": " << run.m_Stats.m_lPacketsDemuxed << ", \"bytes\": " << run.m_Stats.m_lBytesDemuxed
+			<< ", \"decoded\": " << run.m_Stats.m_lFramesDecoded << ", \"dropped\": " << run.m_Stats.m_lFramesDropped
+			<< ", \"presented\": " << run.m_Stats.m_lFramesPresented << ", \"packet_shell_allocations\": " << run.m_Stats.m_lPacketShellAllocations
+			<< ", \"packet_payload_allocations\": " << run.m_Stats.m_lPacketPayloadAllocations << "},\n";
+		out << "\t\t\t\"stages_ms\": {\n";
+		writeTiming(out, "demux", run.m_Stats.m_Demux);
+		writeTiming(out, "video_decode", run.m_Stats.m_VideoDecode);
+		writeTiming(out, "audio_decode", run.m_Stats.m_AudioDecode);
+		writeTiming(out, "scale", run.m_Stats.m_Scale);
+		writeTiming(out, "copy", run.m_Stats.m_Copy, true);
+		out << "\t\t\t}\n";
+		out << "\t\t}" << ((i + 1 < runs.size()) ? ",\n" : "\n");
+	}
+	out << "\t]\n}\n";
+}
+
+static BenchmarkRun runFile(const std::string& strFile, int iFormat, int iScaler, long lMaxFrames, double dTimeoutMs)
+{
+	BenchmarkRun run;
+	run.m_strFile = strFile;
+	run.m_strFormat = s_FormatNames[iFormat];
+	run.m_bOpened = false;
+	run.m_bTimedOut = false;
+	run.m_iWidth = run.m_iHeight = 0;
+	run.m_lFrames = 0;
+	run.m_dOpenMs = run.m_dFirstFrameMs = run.m_dElapsedMs = 0;
+	memset(&run.m_Stats, 0, sizeof(run.m_Stats));
+
+	FFmpegWrapper player;
+	player.setOutputFormat(s_Formats[iFormat], 0, 0, s_Scalers[iScaler]);
+	player.setSeekIndexEnabled(false);		// its thread would compete with the decoder
+	player.setAudioSyncEnabled(false);
+	player.setRealtimeEnabled(false);		// every frame as soon as it is decoded
+
+	boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+	run.m_bOpened = player.open(strFile);
+	run.m_dOpenMs = getMilliSeconds(start);
+	if(!run.m_bOpened || !player.hasVideo())
+		return run;
+	run.m_strCodec = player.getVideoCodecName();
+	run.m_iWidth = player.getWidth();
+	run.m_iHeight = player.getHeight();
+	player.setLoopMode(eNoLoop);
+
+	// polled like a render loop would, just without waiting for vsync, so this takes one core
+	start = boost::chrono::steady_clock::now();
+	boost::chrono::steady_clock::time_point lastFrame = start;
+	player.play();
+	while(player.getState() != eEof && (lMaxFrames <= 0 || run.m_lFrames < lMaxFrames))
+	{
+		if(!player.isNewFrame())
+		{
+			if(getMilliSeconds(start) > dTimeoutMs)
+			{
+				run.m_bTimedOut = true;
+				break;
+			}
+			boost::this_thread::yield();
+			continue;
+		}
+		boost::chrono::steady_clock::time_point now = boost::chrono::steady_clock::now();
+		if(run.m_lFrames == 0)
+			run.m_dFirstFrameMs = boost::chrono::duration<double, boost::milli>(now - start).count();
+		else
+			run.m_Intervals.push_back(boost::chrono::duration<double, boost::milli>(now - lastFrame).count());
+		lastFrame = now;
+		run.m_lFrames++;
+	}
+	run.m_dElapsedMs = boost::chrono::duration<double, boost::milli>(lastFrame - start).count();
+	run.m_Stats = player.getStats();
+	player.close();
+	return run;
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> files;
+	std::vector<int> formats;
+	std::string strJsonFile;
+	int iScaler = findName(s_ScalerNames, 5, "bicubic");
+	long lMaxFrames = 0;
+	double dTimeoutMs = 60000;
+
+	for(int i=1; i<argc; i++)
+	{
+		std::string strArg = argv[i];
+		bool bHasValue = i + 1 < argc;
+		if(strArg == "--format" && bHasValue)
+		{
+			std::stringstream list(argv[++i]);
+			std::string strName;
+			while(std::getline(list, strName, ','))
+			{
+				int iFormat = findName(s_FormatNames, 6, strName);
+				if(iFormat < 0)
+				{
+					std::cerr << "unknown format " << strName << std::endl;
+					return 1;
+				}
+				formats.push_back(iFormat);
+			}
+		}
+		else if(strArg == "--scaler" && bHasValue)
+		{
+			iScaler = findName(s_ScalerNames, 5, argv[++i]);
+			if(iScaler < 0)
+			{
+				std::cerr << "unknown scaler " << argv[i] << std::endl;
+				return 1;
+			}
+		}
+		else if(strArg == "--frames" && bHasValue)
+			lMaxFrames = atol(argv[++i]);
+		else if(strArg == "--timeout" && bHasValue)
+			dTimeoutMs = atof(argv[++i]) * 1000.0;
+		else if(strArg == "--json" && bHasValue)
+			strJsonFile = argv[++i];
+		else if(strArg.compare(0, 2, "--") == 0)
+		{
+			std::cerr << "usage: benchmark [--format rgb24,native,bgra,rgba,gray8,nv12] [--scaler name] [--frames n] [--timeout s] [--json file] [files]" << std::endl;
+			return 1;
+		}
+		else
+			files.push_back(strArg);
+	}
+	if(files.empty())
+		files.push_back("data/morph.avi");
+	if(formats.empty())
+		formats.push_back(0);
+
+	std::vector<BenchmarkRun> runs;
+	bool bAllOpened = true;
+	for(size_t i=0; i<files.size(); i++)
+	{
+		for(size_t j=0; j<formats.size(); j++)
+		{
+			runs.push_back(runFile(files[i], formats[j], iScaler, lMaxFrames, dTimeoutMs));
+			const BenchmarkRun& run = runs.back();
+			bAllOpened = bAllOpened && run.m_bOpened;
+			double dSeconds = run.m_dElapsedMs / 1000.0;
+			std::cerr << run.m_strFile << " [" << run.m_strFormat << "] " << (run.m_bOpened ? "" : "can't be opened ") << run.m_lFrames << " frames, "
+				<< ((dSeconds > 0) ? run.m_lFrames / dSeconds : 0) << " fps" << (run.m_bTimedOut ? ", timed out" : "") << std::endl;
+		}
+	}
+
+	if(strJsonFile.empty())
+		writeJson(std::cout, runs);
+	else
+	{
+		std::ofstream out(strJsonFile.c_str());
+		if(!out)
+		{
+			std::cerr << "can't write " << strJsonFile << std::endl;
+			return 1;
+		}
+		writeJson(out, runs);
+	}
+	return bAllOpened ? 0 : 2;
+}
@@ -0,0 +1,144 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	Helpers shared by the benchmark programs
+*/
+
+#pragma once
+
+#include "_2RealFFmpegWrapper.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <boost/chrono.hpp>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+	#include <psapi.h>
+	#pragma comment(lib, "psapi.lib")
+#else
+	#include <sys/resource.h>
+	#include <unistd.h>
+#endif
+
+// command line names of the output formats and scalers
+static const char* const s_FormatNames[] = {"rgb24", "native", "bgra", "rgba", "gray8", "nv12"};
+static const int s_Formats[] = {_2RealFFmpegWrapper::eOutputRGB24, _2RealFFmpegWrapper::eOutputNative, _2RealFFmpegWrapper::eOutputBGRA, _2RealFFmpegWrapper::eOutputRGBA, _2RealFFmpegWrapper::eOutputGray8, _2RealFFmpegWrapper::eOutputNV12};
+static const char* const s_ScalerNames[] = {"fastbilinear", "bilinear", "bicubic", "point", "area"};
+static const int s_Scalers[] = {_2RealFFmpegWrapper::eScaleFastBilinear, _2RealFFmpegWrapper::eScaleBilinear, _2RealFFmpegWrapper::eScaleBicubic, _2RealFFmpegWrapper::eScalePoint, _2RealFFmpegWrapper::eScaleArea};
+
+inline double getMilliSeconds(const boost::chrono::steady_clock::time_point& start)
+{
+	return boost::chrono::duration<double, boost::milli>(boost::chrono::steady_clock::now() - start).count();
+}
+
+inline int findName(const char* const* names, int iCount, const std::string& strName)
+{
+	for(int i=0; i<iCount; i++)
+	{
+		if(strName == names[i])
+			return i;
+	}
+	return -1;
+}
+
+// nearest rank of the sorted values
+inline double getPercentile(const std::vector<double>& sorted, double dPercent)
+{
+	if(sorted.empty())
+		return 0;
+	size_t iRank = (size_t)(dPercent / 100.0 * sorted.size() + 0.5);
+	if(iRank < 1)
+		iRank = 1;
+	if(iRank > sorted.size())
+		iRank = sorted.size();
+	return sorted[iRank - 1];
+}
+
+inline std::string escapeJson(const std::string& strValue)
+{
+	std::string strEscaped;
+	for(size_t i=0; i<strValue.size(); i++)
+	{
+		char c = strValue[i];
+		if(c == '"' || c == '\\')
+		{
+			strEscaped += '\\';
+			strEscaped += c;
+		}
+		else if((unsigned char)c < 0x20)
+		{
+			char strCode[8];
+			sprintf(strCode, "\\u%04x", (unsigned char)c);
+			strEscaped += strCode;
+		}
+		else
+			strEscaped += c;
+	}
+	return strEscaped;
+}
+
+// resident memory of the process
+inline double getResidentMegaBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if(!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return 0;
+	return counters.WorkingSetSize / (1024.0 * 1024.0);
+#else
+	long lPages = 0, lResident = 0;
+	FILE* pFile = fopen("/proc/self/statm", "r");
+	if(pFile == nullptr)
+		return 0;
+	if(fscanf(pFile, "%ld %ld", &lPages, &lResident) != 2)
+		lResident = 0;
+	fclose(pFile);
+	return lResident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#endif
+}
+
+// user and kernel time of all threads of the process
+inline double getProcessCpuSeconds()
+{
+#ifdef _WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if(!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+		return 0;
+	ULARGE_INTEGER kernel, user;
+	kernel.LowPart = kernelTime.dwLowDateTime;
+	kernel.HighPart = kernelTime.dwHighDateTime;
+	user.LowPart = userTime.dwLowDateTime;
+	user.HighPart = userTime.dwHighDateTime;
+	return (kernel.QuadPart + user.QuadPart) / 10000000.0;		// in 100 ns
+#else
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+	return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000000.0;
+#endif
+}
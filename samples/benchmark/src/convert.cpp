@@ -0,0 +1,259 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This benchmark uses _2RealFFmpegWrapper, and of course FFmpeg, it needs neither a window nor a sound card
+*/
+
+// times the pixel conversion kernels of the wrapper against sws_scale for the conversions they cover, yuv420p, nv12 and
+// rgb24 to bgra and rgba at the same size, every kernel the cpu supports is run, and reports the largest difference to
+// the swscale output per channel value, which stays small as both use bt.601 limited range
+//
+// usage: convert [--size 1920x1080] [--iterations n] [--align bytes] [--json file]
+//   --align	row alignment of the output, like FFmpegWrapper::setOutputRowAlignment, default 16
+
+#include "_2RealPixelConverter.h"
+#include "benchmarkUtils.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/chrono.hpp>
+
+// ffmpeg includes
+extern "C" {
+	#define __STDC_CONSTANT_MACROS
+	#include "stdint.h"
+	#include "libavcodec/avcodec.h"
+	#include "libavutil/imgutils.h"
+	#include "libavutil/mem.h"
+	#include "libswscale/swscale.h"
+}
+
+using namespace _2RealFFmpegWrapper;
+
+static const char* s_SourceNames[] = {"yuv420p", "nv12", "rgb24"};
+static const PixelFormat s_Sources[] = {PIX_FMT_YUV420P, PIX_FMT_NV12, PIX_FMT_RGB24};
+static const char* s_TargetNames[] = {"bgra", "rgba"};
+static const PixelFormat s_Targets[] = {PIX_FMT_BGRA, PIX_FMT_RGBA};
+
+struct Picture
+{
+	uint8_t*	m_pPlanes[4];
+	int			m_iLinesizes[4];
+};
+
+// rows aligned to iAlignment, like the frame pools of the wrapper do it
+static bool allocatePicture(Picture& picture, PixelFormat format, int iWidth, int iHeight, int iAlignment)
+{
+	if(av_image_fill_linesizes(picture.m_iLinesizes, format, iWidth) < 0)
+		return false;
+	for(int i=0; i<4; i++)
+		picture.m_iLinesizes[i] = (picture.m_iLinesizes[i] + iAlignment - 1) & ~(iAlignment - 1);
+	int iSize = av_image_fill_pointers(picture.m_pPlanes, format, iHeight, nullptr, picture.m_iLinesizes);
+	uint8_t* pBuffer = (uint8_t*)av_malloc(iSize);
+	if(pBuffer == nullptr)
+		return false;
+	av_image_fill_pointers(picture.m_pPlanes, format, iHeight, pBuffer, picture.m_iLinesizes);
+	return true;
+}
+
+static void freePicture(Picture& picture)
+{
+	av_free(picture.m_pPlanes[0]);
+	picture.m_pPlanes[0] = nullptr;
+}
+
+// smooth gradients with some noise, so neither the kernels nor swscale see only flat areas
+static void fillPicture(Picture& picture, PixelFormat format, int iWidth, int iHeight)
+{
+	unsigned int iSeed = 1;
+	for(int iPlane=0; iPlane<4 && picture.m_pPlanes[iPlane] != nullptr; iPlane++)
+	{
+		bool bChroma = (iPlane > 0);
+		int iRows = bChroma ? (iHeight + 1) / 2 : iHeight;
+		int iBytes = (format == PIX_FMT_RGB24) ? iWidth * 3 : (bChroma && format == PIX_FMT_YUV420P) ? (iWidth + 1) / 2 : iWidth;
+		for(int y=0; y<iRows; y++)
+		{
+			uint8_t* pRow = picture.m_pPlanes[iPlane] + y * picture.m_iLinesizes[iPlane];
+			for(int x=0; x<iBytes; x++)
+			{
+				iSeed = iSeed * 1103515245 + 12345;
+				pRow[x] = (uint8_t)(((x + y + iPlane * 64) & 255) ^ ((iSeed >> 16) & 15));
+			}
+		}
+	}
+}
+
+static int getMaxDifference(const Picture& a, const Picture& b, int iWidth, int iHeight)
+{
+	int iMax = 0;
+	for(int y=0; y<iHeight; y++)
+	{
+		const uint8_t* pA = a.m_pPlanes[0] + y * a.m_iLinesizes[0];
+		const uint8_t* pB = b.m_pPlanes[0] + y * b.m_iLinesizes[0];
+		for(int x=0; x<iWidth * 4; x++)
+		{
+			int iDifference = abs(pA[x] - pB[x]);
+			if(iDifference > iMax)
+				iMax = iDifference;
+		}
+	}
+	return iMax;
+}
+
+struct Result
+{
+	std::string		m_strSource;
+	std::string		m_strTarget;
+	std::string		m_strMethod;
+	double			m_dMsPerFrame;
+	double			m_dSpeedup;			// relative to sws_scale
+	int				m_iMaxDifference;	// to the sws_scale output
+};
+
+int main(int argc, char* argv[])
+{
+	int iWidth = 1920;
+	int iHeight = 1080;
+	int iIterations = 200;
+	int iAlignment = 16;
+	std::string strJsonFile;
+
+	for(int i=1; i<argc; i++)
+	{
+		std::string strArg = argv[i];
+		bool bHasValue = i + 1 < argc;
+		if(strArg == "--size" && bHasValue)
+		{
+			if(sscanf(argv[++i], "%dx%d", &iWidth, &iHeight) != 2 || iWidth <= 0 || iHeight <= 0)
+			{
+				std::cerr << "invalid size " << argv[i] << std::endl;
+				return 1;
+			}
+		}
+		else if(strArg == "--iterations" && bHasValue)
+			iIterations = atoi(argv[++i]);
+		else if(strArg == "--align" && bHasValue)
+			iAlignment = atoi(argv[++i]);
+		else if(strArg == "--json" && bHasValue)
+			strJsonFile = argv[++i];
+		else
+		{
+			std::cerr << "usage: convert [--size 1920x1080] [--iterations n] [--align bytes] [--json file]" << std::endl;
+			return 1;
+		}
+	}
+	if(iIterations < 1)
+		iIterations = 1;
+	if(iAlignment < 1 || (iAlignment & (iAlignment - 1)) != 0)
+	{
+		std::cerr << "the alignment has to be a power of two" << std::endl;
+		return 1;
+	}
+
+	std::vector<Result> results;
+	for(int iSource=0; iSource<3; iSource++)
+	{
+		Picture source;
+		if(!allocatePicture(source, s_Sources[iSource], iWidth, iHeight, 32))
+			return 2;
+		fillPicture(source, s_Sources[iSource], iWidth, iHeight);
+
+		for(int iTarget=0; iTarget<2; iTarget++)
+		{
+			Picture reference, output;
+			if(!allocatePicture(reference, s_Targets[iTarget], iWidth, iHeight, iAlignment) || !allocatePicture(output, s_Targets[iTarget], iWidth, iHeight, iAlignment))
+				return 2;
+
+			// what the wrapper did for these conversions before, the scaler flags don't matter without scaling
+			SwsContext* pContext = sws_getContext(iWidth, iHeight, s_Sources[iSource], iWidth, iHeight, s_Targets[iTarget], SWS_BICUBIC, nullptr, nullptr, nullptr);
+			if(pContext == nullptr)
+				return 2;
+			boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+			for(int i=0; i<iIterations; i++)
+				sws_scale(pContext, source.m_pPlanes, source.m_iLinesizes, 0, iHeight, reference.m_pPlanes, reference.m_iLinesizes);
+			double dSwsMs = getMilliSeconds(start) / iIterations;
+			sws_freeContext(pContext);
+
+			Result result;
+			result.m_strSource = s_SourceNames[iSource];
+			result.m_strTarget = s_TargetNames[iTarget];
+			result.m_strMethod = "sws_scale";
+			result.m_dMsPerFrame = dSwsMs;
+			result.m_dSpeedup = 1.0;
+			result.m_iMaxDifference = 0;
+			results.push_back(result);
+
+			for(int iKernel=PixelConverter::eKernelScalar; iKernel<=PixelConverter::getBestKernel(); iKernel++)
+			{
+				PixelConverter::Function pConvert = PixelConverter::find(s_Sources[iSource], s_Targets[iTarget], iKernel);
+				if(pConvert == nullptr)
+					continue;
+				memset(output.m_pPlanes[0], 0, output.m_iLinesizes[0] * iHeight);
+				start = boost::chrono::steady_clock::now();
+				for(int i=0; i<iIterations; i++)
+					pConvert(source.m_pPlanes, source.m_iLinesizes, output.m_pPlanes[0], output.m_iLinesizes[0], iWidth, iHeight);
+				result.m_strMethod = PixelConverter::getKernelName(iKernel);
+				result.m_dMsPerFrame = getMilliSeconds(start) / iIterations;
+				result.m_dSpeedup = (result.m_dMsPerFrame > 0) ? dSwsMs / result.m_dMsPerFrame : 0;
+				result.m_iMaxDifference = getMaxDifference(reference, output, iWidth, iHeight);
+				results.push_back(result);
+			}
+			freePicture(reference);
+			freePicture(output);
+		}
+		freePicture(source);
+	}
+
+	std::stringstream json;
+	json << "{\n\t\"width\": " << iWidth << ",\n\t\"height\": " << iHeight << ",\n\t\"iterations\": " << iIterations
+		<< ",\n\t\"row_alignment\": " << iAlignment << ",\n\t\"best_kernel\": \"" << PixelConverter::getKernelName(PixelConverter::eKernelBest) << "\",\n\t\"results\": [\n";
+	for(size_t i=0; i<results.size(); i++)
+	{
+		const Result& result = results[i];
+		json << "\t\t{\"source\": \"" << result.m_strSource << "\", \"target\": \"" << result.m_strTarget << "\", \"method\": \"" << result.m_strMethod
+			<< "\", \"ms_per_frame\": " << result.m_dMsPerFrame << ", \"mpixels_per_s\": " << ((result.m_dMsPerFrame > 0) ? iWidth * (double)iHeight / result.m_dMsPerFrame / 1000.0 : 0)
+			<< ", \"speedup\": " << result.m_dSpeedup << ", \"max_difference\": " << result.m_iMaxDifference << "}" << ((i + 1 < results.size()) ? ",\n" : "\n");
+	}
+	json << "\t]\n}\n";
+
+	if(strJsonFile.empty())
+		std::cout << json.str();
+	else
+	{
+		std::ofstream out(strJsonFile.c_str());
+		if(!out)
+		{
+			std::cerr << "can't write " << strJsonFile << std::endl;
+			return 1;
+		}
+		out << json.str();
+	}
+	return 0;
+}
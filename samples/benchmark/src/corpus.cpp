@@ -0,0 +1,775 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This tool uses FFmpeg, the encoders of the libraries the wrapper links against write the benchmark corpus
+*/
+
+// writes a deterministic set of clips and stills for benchmarks and seek tests: 360p to 2160p, all intra up to gop 250,
+// mpeg4, mpeg2, mjpeg and h264 (when the libraries come with libx264), with and without b-frames, no audio, mono, stereo,
+// 5.1 and pcm, plus png and jpeg stills. the encoders run single threaded and bitexact, so the same libraries always
+// produce the same bytes. corpus.json in the output directory lists every file with its parameters
+//
+// every frame shows moving gradients and a bar, the top left row of 16 squares holds the frame number in binary (msb
+// first, white is 1), so seek and reverse playback tests can check which frame they got. every channel of the audio is
+// a sine of 220 Hz times its channel number, with a 10 ms beep of 1 kHz at every full second
+//
+// usage: corpus [--out dir] [--seconds s] [--fps n] [--max-height h] [--only name] [--list]
+//   --out			default data/corpus, so run it from bin like the samples
+//   --seconds		length of the clips, default 10
+//   --fps			frame rate of the clips, default 25
+//   --max-height	skips bigger clips, e.g. 1080 to leave out 4k
+//   --only		just the clips and stills whose name contains the text
+//   --list		prints the names without writing anything
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+// ffmpeg includes
+extern "C" {
+	#define __STDC_CONSTANT_MACROS
+	#include "stdint.h"
+	#include "libavformat/avformat.h"
+	#include "libavcodec/avcodec.h"
+	#include "libavutil/avutil.h"
+	#include "libavutil/mathematics.h"
+	#include "libavutil/opt.h"
+	#include "libavutil/audioconvert.h"
+	#include "libavutil/samplefmt.h"
+	#include "libswscale/swscale.h"
+}
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+struct AudioLayout
+{
+	const char*		m_strName;
+	const char*		m_strEncoder;		// nullptr .. no audio
+	uint64_t		m_lChannelLayout;
+	int				m_iSampleRate;
+};
+
+static const AudioLayout s_AudioLayouts[] =
+{
+	{ "none", nullptr, 0, 0 },
+	{ "mono", "mp2", AV_CH_LAYOUT_MONO, 44100 },
+	{ "stereo", "mp2", AV_CH_LAYOUT_STEREO, 48000 },
+	{ "5.1", "ac3", AV_CH_LAYOUT_5POINT1, 48000 },
+	{ "pcm_stereo", "pcm_s16le", AV_CH_LAYOUT_STEREO, 48000 }
+};
+enum { eNoAudio, eMono, eStereo, eSurround, ePcmStereo };
+
+struct ClipPreset
+{
+	const char*		m_strName;
+	const char*		m_strEncoder;
+	const char*		m_strExtension;		// picks the container
+	int				m_iWidth;
+	int				m_iHeight;
+	int				m_iGop;				// 1 .. all intra
+	int				m_iBFrames;
+	int				m_iAudio;
+};
+
+static const ClipPreset s_Clips[] =
+{
+	{ "mpeg4_360p_gop12", "mpeg4", ".avi", 640, 360, 12, 0, eStereo },
+	{ "mpeg4_360p_intra", "mpeg4", ".avi", 640, 360, 1, 0, eMono },
+	{ "mpeg4_720p_gop50_b2", "mpeg4", ".mp4", 1280, 720, 50, 2, eStereo },
+	{ "mpeg4_1080p_gop250_b2", "mpeg4", ".mp4", 1920, 1080, 250, 2, eStereo },
+	{ "mpeg4_2160p_gop25", "mpeg4", ".mp4", 3840, 2160, 25, 0, eNoAudio },
+	{ "mpeg2_720p_gop12_b2", "mpeg2video", ".mpg", 1280, 720, 12, 2, eStereo },
+	{ "mpeg2_1080p_gop50_b2", "mpeg2video", ".ts", 1920, 1080, 50, 2, eSurround },
+	{ "mjpeg_720p_intra", "mjpeg", ".avi", 1280, 720, 1, 0, ePcmStereo },
+	{ "mjpeg_1080p_intra", "mjpeg", ".avi", 1920, 1080, 1, 0, eNoAudio },
+	{ "h264_720p_gop50", "libx264", ".mkv", 1280, 720, 50, 0, eSurround },
+	{ "h264_1080p_gop250_b3", "libx264", ".mkv", 1920, 1080, 250, 3, eStereo },
+	{ "h264_2160p_gop50_b2", "libx264", ".mkv", 3840, 2160, 50, 2, eNoAudio }
+};
+
+struct StillPreset
+{
+	const char*		m_strName;
+	const char*		m_strEncoder;
+	const char*		m_strExtension;
+	int				m_iWidth;
+	int				m_iHeight;
+};
+
+static const StillPreset s_Stills[] =
+{
+	{ "still_360p", "png", ".png", 640, 360 },
+	{ "still_1080p", "png", ".png", 1920, 1080 },
+	{ "still_2160p", "png", ".png", 3840, 2160 },
+	{ "still_1080p", "mjpeg", ".jpg", 1920, 1080 },
+	{ "still_2160p", "mjpeg", ".jpg", 3840, 2160 }
+};
+
+struct Options
+{
+	std::string		m_strOutDirectory;
+	double			m_dSeconds;
+	int				m_iFps;
+	int				m_iMaxHeight;
+	std::string		m_strOnly;
+};
+
+// what ended up in a file, for the manifest
+struct FileResult
+{
+	std::string		m_strFile;
+	std::string		m_strEncoder;
+	int				m_iWidth;
+	int				m_iHeight;
+	int				m_iGop;
+	int				m_iBFrames;
+	long			m_lFrames;
+	long			m_lKeyFrames;
+	const AudioLayout*	m_pAudio;
+	int				m_iChannels;
+	int64_t			m_lBytes;
+};
+
+// draws frame lFrame of the test pattern as rgb24
+static void drawPattern(unsigned char* pRgb, int iLinesize, int iWidth, int iHeight, long lFrame)
+{
+	int iBar = (int)((lFrame * 8) % iWidth);
+	int iBarWidth = iWidth / 32;
+	for(int y=0; y<iHeight; y++)
+	{
+		unsigned char* pLine = pRgb + y * iLinesize;
+		unsigned char g = (unsigned char)((y * 256 / iHeight + lFrame * 2) & 255);
+		for(int x=0; x<iWidth; x++)
+		{
+			pLine[x * 3] = (unsigned char)((x * 256 / iWidth + lFrame * 4) & 255);
+			pLine[x * 3 + 1] = g;
+			pLine[x * 3 + 2] = (unsigned char)((((x >> 5) ^ (y >> 5)) & 1) ? 192 : 64);
+		}
+		int iEnd = (iBar + iBarWidth < iWidth) ? iBar + iBarWidth : iWidth;
+		memset(pLine + iBar * 3, 255, (iEnd - iBar) * 3);
+	}
+
+	// frame number, with a black border so it survives the scaling and compression
+	int iSquare = iHeight / 36;
+	for(int y=0; y<iSquare * 2; y++)
+	{
+		unsigned char* pLine = pRgb + y * iLinesize;
+		memset(pLine, 0, iSquare * 17 * 3);
+		if(y < iSquare / 2 || y >= iSquare * 3 / 2)
+			continue;
+		for(int iBit=0; iBit<16; iBit++)
+		{
+			if(!((lFrame >> (15 - iBit)) & 1))
+				continue;
+			memset(pLine + (iSquare / 2 + iBit * iSquare) * 3, 255, (iSquare * 3 / 4) * 3);
+		}
+	}
+}
+
+// one sample of channel iChannel at sample lSample, -1 .. 1
+static double getAudioSample(int iChannel, int iSampleRate, int64_t lSample)
+{
+	double dTime = (double)lSample / iSampleRate;
+	if(lSample % iSampleRate < iSampleRate / 100)
+		return 0.5 * sin(2.0 * M_PI * 1000.0 * dTime);
+	return 0.25 * sin(2.0 * M_PI * 220.0 * (iChannel + 1) * dTime);
+}
+
+static void fillAudio(unsigned char* pBuffer, AVSampleFormat format, int iChannels, int iSampleRate, int64_t lFirstSample, int iSamples)
+{
+	bool bPlanar = av_sample_fmt_is_planar(format) != 0;
+	bool bFloat = format == AV_SAMPLE_FMT_FLT || format == AV_SAMPLE_FMT_FLTP;
+	for(int c=0; c<iChannels; c++)
+	{
+		for(int i=0; i<iSamples; i++)
+		{
+			double dValue = getAudioSample(c, iSampleRate, lFirstSample + i);
+			int iIndex = bPlanar ? c * iSamples + i : i * iChannels + c;
+			if(bFloat)
+				((float*)pBuffer)[iIndex] = (float)dValue;
+			else
+				((int16_t*)pBuffer)[iIndex] = (int16_t)(dValue * 32767.0);
+		}
+	}
+}
+
+static bool isSupportedSampleFormat(AVSampleFormat format)
+{
+	return format == AV_SAMPLE_FMT_S16 || format == AV_SAMPLE_FMT_S16P || format == AV_SAMPLE_FMT_FLT || format == AV_SAMPLE_FMT_FLTP;
+}
+
+static int64_t getFileSize(const std::string& strFile)
+{
+	boost::system::error_code error;
+	boost::uintmax_t lSize = boost::filesystem::file_size(strFile, error);
+	return error ? 0 : (int64_t)lSize;
+}
+
+// encodes a test pattern picture, scaling it from rgb24 to the pixel format of the encoder
+class PatternSource
+{
+public:
+	PatternSource() : m_pSwsContext(nullptr), m_pFrame(nullptr), m_iWidth(0), m_iHeight(0)
+	{
+		memset(&m_Rgb, 0, sizeof(m_Rgb));
+	}
+	~PatternSource()
+	{
+		if(m_pSwsContext != nullptr)
+			sws_freeContext(m_pSwsContext);
+		if(m_pFrame != nullptr)
+		{
+			avpicture_free(&m_Picture);
+			av_free(m_pFrame);
+		}
+		if(m_Rgb.data[0] != nullptr)
+			avpicture_free(&m_Rgb);
+	}
+
+	bool init(int iWidth, int iHeight, PixelFormat format)
+	{
+		m_iWidth = iWidth;
+		m_iHeight = iHeight;
+		if(avpicture_alloc(&m_Rgb, PIX_FMT_RGB24, iWidth, iHeight) < 0)
+			return false;
+		m_pFrame = avcodec_alloc_frame();
+		if(m_pFrame == nullptr || avpicture_alloc(&m_Picture, format, iWidth, iHeight) < 0)
+		{
+			av_free(m_pFrame);
+			m_pFrame = nullptr;
+			return false;
+		}
+		for(int i=0; i<4; i++)
+		{
+			m_pFrame->data[i] = m_Picture.data[i];
+			m_pFrame->linesize[i] = m_Picture.linesize[i];
+		}
+		m_pSwsContext = sws_getContext(iWidth, iHeight, PIX_FMT_RGB24, iWidth, iHeight, format, SWS_BILINEAR | SWS_BITEXACT, nullptr, nullptr, nullptr);
+		return m_pSwsContext != nullptr;
+	}
+
+	AVFrame* getFrame(long lFrame)
+	{
+		drawPattern(m_Rgb.data[0], m_Rgb.linesize[0], m_iWidth, m_iHeight, lFrame);
+		sws_scale(m_pSwsContext, m_Rgb.data, m_Rgb.linesize, 0, m_iHeight, m_pFrame->data, m_pFrame->linesize);
+		m_pFrame->pts = lFrame;
+		m_pFrame->key_frame = 0;
+		m_pFrame->pict_type = AV_PICTURE_TYPE_NONE;
+		return m_pFrame;
+	}
+
+private:
+	SwsContext*		m_pSwsContext;
+	AVFrame*		m_pFrame;
+	AVPicture		m_Picture;
+	AVPicture		m_Rgb;
+	int				m_iWidth;
+	int				m_iHeight;
+};
+
+// muxes one clip, video is encoded by frame number, audio by sample count, always whatever of both is behind
+class ClipWriter
+{
+public:
+	ClipWriter() : m_pFormatContext(nullptr), m_pVideoStream(nullptr), m_pAudioStream(nullptr), m_pAudioFrame(nullptr),
+		m_iAudioFrameSize(0), m_lFrames(0), m_lKeyFrames(0), m_lSamples(0), m_bHeaderWritten(false) {}
+	~ClipWriter()
+	{
+		close();
+	}
+
+	bool open(const std::string& strFile, const ClipPreset& clip, const AudioLayout& audio, const Options& options)
+	{
+		if(avformat_alloc_output_context2(&m_pFormatContext, nullptr, nullptr, strFile.c_str()) < 0 || m_pFormatContext == nullptr)
+		{
+			std::cerr << "no container for " << strFile << std::endl;
+			return false;
+		}
+		if(!openVideo(clip, options) || (audio.m_strEncoder != nullptr && !openAudio(audio)))
+			return false;
+		if(!(m_pFormatContext->oformat->flags & AVFMT_NOFILE) && avio_open(&m_pFormatContext->pb, strFile.c_str(), AVIO_FLAG_WRITE) < 0)
+		{
+			std::cerr << "can't write " << strFile << std::endl;
+			return false;
+		}
+		if(avformat_write_header(m_pFormatContext, nullptr) < 0)
+		{
+			std::cerr << "can't write the header of " << strFile << std::endl;
+			return false;
+		}
+		m_bHeaderWritten = true;
+		return true;
+	}
+
+	bool write(long lFrames)
+	{
+		AVCodecContext* pVideo = m_pVideoStream->codec;
+		int64_t lAudioSamples = (m_pAudioStream != nullptr) ? av_rescale(lFrames, (int64_t)m_pAudioStream->codec->sample_rate * pVideo->time_base.num, pVideo->time_base.den) : 0;
+		while(m_lFrames < lFrames || m_lSamples < lAudioSamples)
+		{
+			bool bVideo = m_lSamples >= lAudioSamples ||
+				(m_lFrames < lFrames && av_compare_ts(m_lFrames, pVideo->time_base, m_lSamples, m_pAudioStream->codec->time_base) <= 0);
+			if(bVideo ? !writeVideo(m_Pattern.getFrame(m_lFrames)) : !writeAudio())
+				return false;
+		}
+		// the delayed frames of encoders with b-frames or lookahead
+		if(!writeVideo(nullptr))
+			return false;
+		return m_pAudioStream == nullptr || flushAudio();
+	}
+
+	bool finish()
+	{
+		if(!m_bHeaderWritten)
+			return false;
+		m_bHeaderWritten = false;
+		return av_write_trailer(m_pFormatContext) == 0;
+	}
+
+	long getFrames() { return m_lFrames; }
+	long getKeyFrames() { return m_lKeyFrames; }
+	int getChannels() { return (m_pAudioStream != nullptr) ? m_pAudioStream->codec->channels : 0; }
+
+private:
+	bool openVideo(const ClipPreset& clip, const Options& options)
+	{
+		AVCodec* pCodec = avcodec_find_encoder_by_name(clip.m_strEncoder);
+		if(pCodec == nullptr)
+		{
+			std::cerr << "the libraries come without the " << clip.m_strEncoder << " encoder" << std::endl;
+			return false;
+		}
+		m_pVideoStream = avformat_new_stream(m_pFormatContext, pCodec);
+		if(m_pVideoStream == nullptr)
+			return false;
+		AVCodecContext* pContext = m_pVideoStream->codec;
+		pContext->width = clip.m_iWidth;
+		pContext->height = clip.m_iHeight;
+		pContext->time_base.num = 1;
+		pContext->time_base.den = options.m_iFps;
+		pContext->gop_size = clip.m_iGop;
+		pContext->max_b_frames = clip.m_iBFrames;
+		pContext->pix_fmt = (pCodec->pix_fmts != nullptr) ? pCodec->pix_fmts[0] : PIX_FMT_YUV420P;
+		pContext->thread_count = 1;
+		pContext->flags |= CODEC_FLAG_BITEXACT;
+		if(strcmp(clip.m_strEncoder, "libx264") == 0)
+		{
+			av_opt_set(pContext->priv_data, "preset", "veryfast", 0);
+			av_opt_set(pContext->priv_data, "crf", "23", 0);
+		}
+		else
+		{
+			// constant quantizer, so the size follows the content and not a bitrate guess
+			pContext->flags |= CODEC_FLAG_QSCALE;
+			pContext->global_quality = FF_QP2LAMBDA * 4;
+		}
+		if(clip.m_iGop == 1)
+			pContext->keyint_min = 1;
+		if(m_pFormatContext->oformat->flags & AVFMT_GLOBALHEADER)
+			pContext->flags |= CODEC_FLAG_GLOBAL_HEADER;
+		if(avcodec_open2(pContext, pCodec, nullptr) < 0)
+		{
+			std::cerr << "can't open the " << clip.m_strEncoder << " encoder" << std::endl;
+			return false;
+		}
+		return m_Pattern.init(clip.m_iWidth, clip.m_iHeight, pContext->pix_fmt);
+	}
+
+	bool openAudio(const AudioLayout& audio)
+	{
+		AVCodec* pCodec = avcodec_find_encoder_by_name(audio.m_strEncoder);
+		if(pCodec == nullptr || pCodec->sample_fmts == nullptr)
+		{
+			std::cerr << "the libraries come without the " << audio.m_strEncoder << " encoder" << std::endl;
+			return false;
+		}
+		AVSampleFormat format = AV_SAMPLE_FMT_NONE;
+		for(const AVSampleFormat* pFormat = pCodec->sample_fmts; *pFormat != AV_SAMPLE_FMT_NONE && format == AV_SAMPLE_FMT_NONE; pFormat++)
+		{
+			if(isSupportedSampleFormat(*pFormat))
+				format = *pFormat;
+		}
+		if(format == AV_SAMPLE_FMT_NONE)
+		{
+			std::cerr << "no supported sample format for " << audio.m_strEncoder << std::endl;
+			return false;
+		}
+		m_pAudioStream = avformat_new_stream(m_pFormatContext, pCodec);
+		if(m_pAudioStream == nullptr)
+			return false;
+		AVCodecContext* pContext = m_pAudioStream->codec;
+		pContext->sample_fmt = format;
+		pContext->sample_rate = audio.m_iSampleRate;
+		pContext->channel_layout = audio.m_lChannelLayout;
+		pContext->channels = av_get_channel_layout_nb_channels(audio.m_lChannelLayout);
+		pContext->time_base.num = 1;
+		pContext->time_base.den = audio.m_iSampleRate;
+		pContext->bit_rate = 64000 * pContext->channels;
+		pContext->thread_count = 1;
+		pContext->flags |= CODEC_FLAG_BITEXACT;
+		if(m_pFormatContext->oformat->flags & AVFMT_GLOBALHEADER)
+			pContext->flags |= CODEC_FLAG_GLOBAL_HEADER;
+		if(avcodec_open2(pContext, pCodec, nullptr) < 0)
+		{
+			std::cerr << "can't open the " << audio.m_strEncoder << " encoder for " << audio.m_strName << std::endl;
+			return false;
+		}
+		// pcm takes any number of samples
+		m_iAudioFrameSize = (pContext->frame_size > 0 && !(pCodec->capabilities & CODEC_CAP_VARIABLE_FRAME_SIZE)) ? pContext->frame_size : 1024;
+		m_AudioBuffer.resize(av_samples_get_buffer_size(nullptr, pContext->channels, m_iAudioFrameSize, format, 1));
+		m_pAudioFrame = avcodec_alloc_frame();
+		return m_pAudioFrame != nullptr;
+	}
+
+	bool writeVideo(AVFrame* pFrame)
+	{
+		AVCodecContext* pContext = m_pVideoStream->codec;
+		if(pFrame == nullptr && !(pContext->codec->capabilities & CODEC_CAP_DELAY))
+			return true;
+		for(;;)
+		{
+			AVPacket packet;
+			av_init_packet(&packet);
+			packet.data = nullptr;
+			packet.size = 0;
+			int iGotPacket = 0;
+			if(avcodec_encode_video2(pContext, &packet, pFrame, &iGotPacket) < 0)
+			{
+				std::cerr << "video encoding failed" << std::endl;
+				return false;
+			}
+			if(pFrame != nullptr)
+				m_lFrames++;
+			if(iGotPacket && !writePacket(packet, m_pVideoStream))
+				return false;
+			if(iGotPacket && (packet.flags & AV_PKT_FLAG_KEY))
+				m_lKeyFrames++;
+			// just the flush loops until the encoder is empty
+			if(pFrame != nullptr || !iGotPacket)
+				return true;
+		}
+	}
+
+	bool writeAudio()
+	{
+		AVCodecContext* pContext = m_pAudioStream->codec;
+		avcodec_get_frame_defaults(m_pAudioFrame);
+		m_pAudioFrame->nb_samples = m_iAudioFrameSize;
+		m_pAudioFrame->pts = m_lSamples;
+		fillAudio(&m_AudioBuffer[0], pContext->sample_fmt, pContext->channels, pContext->sample_rate, m_lSamples, m_iAudioFrameSize);
+		if(avcodec_fill_audio_frame(m_pAudioFrame, pContext->channels, pContext->sample_fmt, &m_AudioBuffer[0], (int)m_AudioBuffer.size(), 1) < 0)
+			return false;
+		m_lSamples += m_iAudioFrameSize;
+		return encodeAudio(m_pAudioFrame) >= 0;
+	}
+
+	bool flushAudio()
+	{
+		if(!(m_pAudioStream->codec->codec->capabilities & CODEC_CAP_DELAY))
+			return true;
+		int iResult;
+		while((iResult = encodeAudio(nullptr)) > 0)
+			;
+		return iResult == 0;
+	}
+
+	// returns 1 if a packet was written, 0 if not, -1 on errors
+	int encodeAudio(AVFrame* pFrame)
+	{
+		AVPacket packet;
+		av_init_packet(&packet);
+		packet.data = nullptr;
+		packet.size = 0;
+		int iGotPacket = 0;
+		if(avcodec_encode_audio2(m_pAudioStream->codec, &packet, pFrame, &iGotPacket) < 0)
+		{
+			std::cerr << "audio encoding failed" << std::endl;
+			return -1;
+		}
+		if(!iGotPacket)
+			return 0;
+		return writePacket(packet, m_pAudioStream) ? 1 : -1;
+	}
+
+	bool writePacket(AVPacket& packet, AVStream* pStream)
+	{
+		AVRational timeBase = pStream->codec->time_base;
+		if(packet.pts != (int64_t)AV_NOPTS_VALUE)
+			packet.pts = av_rescale_q(packet.pts, timeBase, pStream->time_base);
+		if(packet.dts != (int64_t)AV_NOPTS_VALUE)
+			packet.dts = av_rescale_q(packet.dts, timeBase, pStream->time_base);
+		if(packet.duration > 0)
+			packet.duration = (int)av_rescale_q(packet.duration, timeBase, pStream->time_base);
+		packet.stream_index = pStream->index;
+		if(av_interleaved_write_frame(m_pFormatContext, &packet) < 0)
+		{
+			std::cerr << "muxing failed" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	void close()
+	{
+		if(m_pFormatContext == nullptr)
+			return;
+		finish();
+		for(unsigned int i=0; i<m_pFormatContext->nb_streams; i++)
+			avcodec_close(m_pFormatContext->streams[i]->codec);
+		if(m_pFormatContext->pb != nullptr && !(m_pFormatContext->oformat->flags & AVFMT_NOFILE))
+			avio_close(m_pFormatContext->pb);
+		avformat_free_context(m_pFormatContext);
+		m_pFormatContext = nullptr;
+		av_free(m_pAudioFrame);
+		m_pAudioFrame = nullptr;
+	}
+
+	AVFormatContext*			m_pFormatContext;
+	AVStream*					m_pVideoStream;
+	AVStream*					m_pAudioStream;
+	AVFrame*					m_pAudioFrame;
+	std::vector<unsigned char>	m_AudioBuffer;
+	int							m_iAudioFrameSize;
+	PatternSource				m_Pattern;
+	long						m_lFrames;
+	long						m_lKeyFrames;
+	int64_t						m_lSamples;
+	bool						m_bHeaderWritten;
+};
+
+static bool writeClip(const ClipPreset& clip, const Options& options, FileResult& result)
+{
+	const AudioLayout& audio = s_AudioLayouts[clip.m_iAudio];
+	std::string strFile = (boost::filesystem::path(options.m_strOutDirectory) / (std::string(clip.m_strName) + clip.m_strExtension)).string();
+	ClipWriter writer;
+	if(!writer.open(strFile, clip, audio, options) || !writer.write((long)(options.m_dSeconds * options.m_iFps + 0.5)) || !writer.finish())
+		return false;
+
+	result.m_strFile = std::string(clip.m_strName) + clip.m_strExtension;
+	result.m_strEncoder = clip.m_strEncoder;
+	result.m_iWidth = clip.m_iWidth;
+	result.m_iHeight = clip.m_iHeight;
+	result.m_iGop = clip.m_iGop;
+	result.m_iBFrames = clip.m_iBFrames;
+	result.m_lFrames = writer.getFrames();
+	result.m_lKeyFrames = writer.getKeyFrames();
+	result.m_pAudio = &audio;
+	result.m_iChannels = writer.getChannels();
+	result.m_lBytes = getFileSize(strFile);
+	return true;
+}
+
+// png and jpeg encoders put out complete files, so no muxer is needed
+static bool writeStill(const StillPreset& still, const Options& options, FileResult& result)
+{
+	AVCodec* pCodec = avcodec_find_encoder_by_name(still.m_strEncoder);
+	if(pCodec == nullptr)
+	{
+		std::cerr << "the libraries come without the " << still.m_strEncoder << " encoder" << std::endl;
+		return false;
+	}
+	AVCodecContext* pContext = avcodec_alloc_context3(pCodec);
+	if(pContext == nullptr)
+		return false;
+	pContext->width = still.m_iWidth;
+	pContext->height = still.m_iHeight;
+	pContext->time_base.num = 1;
+	pContext->time_base.den = options.m_iFps;
+	pContext->pix_fmt = (pCodec->pix_fmts != nullptr) ? pCodec->pix_fmts[0] : PIX_FMT_RGB24;
+	pContext->flags |= CODEC_FLAG_BITEXACT | CODEC_FLAG_QSCALE;
+	pContext->global_quality = FF_QP2LAMBDA * 2;
+	pContext->thread_count = 1;
+
+	bool bSuccess = false;
+	int iBytes = 0;
+	std::string strFile = std::string(still.m_strName) + still.m_strExtension;
+	if(avcodec_open2(pContext, pCodec, nullptr) < 0)
+		std::cerr << "can't open the " << still.m_strEncoder << " encoder" << std::endl;
+	else
+	{
+		PatternSource pattern;
+		AVPacket packet;
+		av_init_packet(&packet);
+		packet.data = nullptr;
+		packet.size = 0;
+		int iGotPacket = 0;
+		if(pattern.init(still.m_iWidth, still.m_iHeight, pContext->pix_fmt) && avcodec_encode_video2(pContext, &packet, pattern.getFrame(0), &iGotPacket) >= 0 && iGotPacket)
+		{
+			std::string strPath = (boost::filesystem::path(options.m_strOutDirectory) / strFile).string();
+			FILE* pFile = fopen(strPath.c_str(), "wb");
+			if(pFile != nullptr)
+			{
+				bSuccess = fwrite(packet.data, 1, packet.size, pFile) == (size_t)packet.size;
+				bSuccess = (fclose(pFile) == 0) && bSuccess;
+			}
+			if(!bSuccess)
+				std::cerr << "can't write " << strPath << std::endl;
+			iBytes = packet.size;
+			av_free_packet(&packet);
+		}
+		avcodec_close(pContext);
+	}
+	av_free(pContext);
+
+	result.m_strFile = strFile;
+	result.m_strEncoder = still.m_strEncoder;
+	result.m_iWidth = still.m_iWidth;
+	result.m_iHeight = still.m_iHeight;
+	result.m_iGop = 1;
+	result.m_iBFrames = 0;
+	result.m_lFrames = result.m_lKeyFrames = 1;
+	result.m_pAudio = &s_AudioLayouts[eNoAudio];
+	result.m_iChannels = 0;
+	result.m_lBytes = iBytes;
+	return bSuccess;
+}
+
+static void writeManifest(std::ostream& out, const std::vector<FileResult>& files, const Options& options)
+{
+	out << "{\n\t\"libavcodec\": \"" << LIBAVCODEC_IDENT << "\",\n\t\"libavformat\": \"" << LIBAVFORMAT_IDENT << "\",\n";
+	out << "\t\"fps\": " << options.m_iFps << ",\n\t\"files\": [\n";
+	for(size_t i=0; i<files.size(); i++)
+	{
+		const FileResult& file = files[i];
+		out << "\t\t{\"file\": \"" << file.m_strFile << "\", \"encoder\": \"" << file.m_strEncoder << "\", \"width\": " << file.m_iWidth
+			<< ", \"height\": " << file.m_iHeight << ", \"gop\": " << file.m_iGop << ", \"b_frames\": " << file.m_iBFrames
+			<< ", \"frames\": " << file.m_lFrames << ", \"key_frames\": " << file.m_lKeyFrames << ", \"audio\": \"" << file.m_pAudio->m_strName
+			<< "\", \"channels\": " << file.m_iChannels << ", \"sample_rate\": " << file.m_pAudio->m_iSampleRate << ", \"bytes\": " << file.m_lBytes << "}"
+			<< ((i + 1 < files.size()) ? ",\n" : "\n");
+	}
+	out << "\t]\n}\n";
+}
+
+static bool isSelected(const char* strName, int iHeight, const Options& options)
+{
+	if(options.m_iMaxHeight > 0 && iHeight > options.m_iMaxHeight)
+		return false;
+	return options.m_strOnly.empty() || std::string(strName).find(options.m_strOnly) != std::string::npos;
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	options.m_strOutDirectory = "data/corpus";
+	options.m_dSeconds = 10;
+	options.m_iFps = 25;
+	options.m_iMaxHeight = 0;
+	bool bList = false;
+
+	for(int i=1; i<argc; i++)
+	{
+		std::string strArg = argv[i];
+		bool bHasValue = i + 1 < argc;
+		if(strArg == "--out" && bHasValue)
+			options.m_strOutDirectory = argv[++i];
+		else if(strArg == "--seconds" && bHasValue)
+			options.m_dSeconds = atof(argv[++i]);
+		else if(strArg == "--fps" && bHasValue)
+			options.m_iFps = atoi(argv[++i]);
+		else if(strArg == "--max-height" && bHasValue)
+			options.m_iMaxHeight = atoi(argv[++i]);
+		else if(strArg == "--only" && bHasValue)
+			options.m_strOnly = argv[++i];
+		else if(strArg == "--list")
+			bList = true;
+		else
+		{
+			std::cerr << "usage: corpus [--out dir] [--seconds s] [--fps n] [--max-height h] [--only name] [--list]" << std::endl;
+			return 1;
+		}
+	}
+	if(options.m_dSeconds <= 0 || options.m_iFps <= 0)
+	{
+		std::cerr << "seconds and fps have to be positive" << std::endl;
+		return 1;
+	}
+
+	int iClips = sizeof(s_Clips) / sizeof(s_Clips[0]);
+	int iStills = sizeof(s_Stills) / sizeof(s_Stills[0]);
+	if(bList)
+	{
+		for(int i=0; i<iClips; i++)
+			std::cout << s_Clips[i].m_strName << s_Clips[i].m_strExtension << std::endl;
+		for(int i=0; i<iStills; i++)
+			std::cout << s_Stills[i].m_strName << s_Stills[i].m_strExtension << std::endl;
+		return 0;
+	}
+
+	boost::system::error_code error;
+	boost::filesystem::create_directories(options.m_strOutDirectory, error);
+	if(error)
+	{
+		std::cerr << "can't create " << options.m_strOutDirectory << std::endl;
+		return 1;
+	}
+
+	av_register_all();
+	av_log_set_level(AV_LOG_ERROR);
+
+	// clips whose encoder is missing are left out, everything else has to work
+	std::vector<FileResult> files;
+	int iFailed = 0;
+	for(int i=0; i<iClips; i++)
+	{
+		if(!isSelected(s_Clips[i].m_strName, s_Clips[i].m_iHeight, options))
+			continue;
+		std::cerr << s_Clips[i].m_strName << s_Clips[i].m_strExtension << std::endl;
+		FileResult result;
+		if(writeClip(s_Clips[i], options, result))
+			files.push_back(result);
+		else if(avcodec_find_encoder_by_name(s_Clips[i].m_strEncoder) != nullptr)
+			iFailed++;
+	}
+	for(int i=0; i<iStills; i++)
+	{
+		if(!isSelected(s_Stills[i].m_strName, s_Stills[i].m_iHeight, options))
+			continue;
+		std::cerr << s_Stills[i].m_strName << s_Stills[i].m_strExtension << std::endl;
+		FileResult result;
+		if(writeStill(s_Stills[i], options, result))
+			files.push_back(result);
+		else
+			iFailed++;
+	}
+
+	std::string strManifest = (boost::filesystem::path(options.m_strOutDirectory) / "corpus.json").string();
+	std::ofstream manifest(strManifest.c_str());
+	if(!manifest)
+	{
+		std::cerr << "can't write " << strManifest << std::endl;
+		return 1;
+	}
+	writeManifest(manifest, files, options);
+	std::cerr << files.size() << " files written to " << options.m_strOutDirectory << ", " << iFailed << " failed" << std::endl;
+	return (iFailed > 0) ? 2 : 0;
+}
@@ -0,0 +1,340 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This benchmark uses _2RealFFmpegWrapper, and of course FFmpeg, it needs neither a window nor a sound card
+*/
+
+// plays growing numbers of players side by side against a simulated 60 Hz vsync, like the tiles of the cinder sample,
+// and reports missed presentations, frame pacing, cpu per player and memory, optionally followed by a long soak run
+//
+// usage: soak [--players 1,2,4,...] [--seconds s] [--soak s] [--slots n] [--format rgb24] [--json file] [files]
+//   --players	player counts to step through, default 1,2,4,8,16,32,64
+//   --seconds	measured per step, after one second of warm up
+//   --soak		seconds to keep the largest count playing afterwards, the resident memory is sampled every 10 s
+//   --slots	decode slots of the PlayerGroup throttle, 0 .. one per core, -1 .. no group, every player decodes whenever it wants
+//   --format	output format, see benchmark
+//   --json		file to write the results to, stdout otherwise
+//   the players take turns on the files, default data/morph.avi, so run it from bin like the samples
+
+#include "_2RealFFmpegWrapper.h"
+#include "_2RealPlayerGroup.h"
+#include "benchmarkUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/chrono.hpp>
+#include <boost/thread.hpp>
+
+using namespace _2RealFFmpegWrapper;
+
+static const double s_dVsyncRate = 60.0;
+
+struct StepResult
+{
+	int						m_iPlayers;
+	int						m_iOpened;
+	double					m_dSeconds;
+	long					m_lVsyncs;
+	long					m_lLateVsyncs;		// the loop woke up after the next vsync was due already
+	long					m_lPresented;
+	double					m_dExpected;		// frames the players should have shown at their frame rates
+	long					m_lDropped;			// skipped by the players as they were late
+	double					m_dIntervalMean;	// between the frames of a player, in ms, relative to its frame duration
+	double					m_dIntervalStdDev;
+	double					m_dIntervalP99;
+	double					m_dIntervalMax;
+	double					m_dCpuPercent;		// of one core
+	double					m_dResidentMB;
+	std::vector<double>		m_ResidentSamples;	// soak only
+};
+
+static void writeStep(std::ostream& out, const StepResult& step, const char* strIndent)
+{
+	long lMissed = (long)floor(step.m_dExpected - step.m_lPresented + 0.5);
+	out << strIndent << "\"players\": " << step.m_iPlayers << ",\n";
+	out << strIndent << "\"opened\": " << step.m_iOpened << ",\n";
+	out << strIndent << "\"seconds\": " << step.m_dSeconds << ",\n";
+	out << strIndent << "\"vsyncs\": " << step.m_lVsyncs << ",\n";
+	out << strIndent << "\"late_vsyncs\": " << step.m_lLateVsyncs << ",\n";
+	out << strIndent << "\"presented\": " << step.m_lPresented << ",\n";
+	out << strIndent << "\"expected\": " << step.m_dExpected << ",\n";
+	out << strIndent << "\"missed\": " << ((lMissed > 0) ? lMissed : 0) << ",\n";
+	out << strIndent << "\"dropped\": " << step.m_lDropped << ",\n";
+	out << strIndent << "\"frame_interval\": {\"mean\": " << step.m_dIntervalMean << ", \"stddev\": " << step.m_dIntervalStdDev
+		<< ", \"p99\": " << step.m_dIntervalP99 << ", \"max\": " << step.m_dIntervalMax << "},\n";
+	out << strIndent << "\"cpu_percent\": " << step.m_dCpuPercent << ",\n";
+	out << strIndent << "\"cpu_percent_per_player\": " << ((step.m_iOpened > 0) ? step.m_dCpuPercent / step.m_iOpened : 0) << ",\n";
+	out << strIndent << "\"resident_mb\": " << step.m_dResidentMB;
+}
+
+static void writeJson(std::ostream& out, const std::vector<StepResult>& steps, const StepResult* pSoak)
+{
+	out << "{\n\t\"version\": \"" << eMajorVersion << "." << eMinorVersion << "." << ePatchVersion << "\",\n";
+	out << "\t\"vsync_hz\": " << s_dVsyncRate << ",\n\t\"steps\": [\n";
+	for(size_t i=0; i<steps.size(); i++)
+	{
+		out << "\t\t{\n";
+		writeStep(out, steps[i], "\t\t\t");
+		out << "\n\t\t}" << ((i + 1 < steps.size()) ? ",\n" : "\n");
+	}
+	out << "\t]";
+	if(pSoak != nullptr)
+	{
+		const std::vector<double>& samples = pSoak->m_ResidentSamples;
+		out << ",\n\t\"soak\": {\n";
+		writeStep(out, *pSoak, "\t\t");
+		out << ",\n\t\t\"resident_samples_mb\": [";
+		for(size_t i=0; i<samples.size(); i++)
+			out << ((i > 0) ? ", " : "") << samples[i];
+		out << "],\n\t\t\"resident_growth_mb\": " << (samples.empty() ? 0 : samples.back() - samples.front()) << "\n\t}";
+	}
+	out << "\n}\n";
+}
+
+// plays iPlayers for one second of warm up and dSeconds measured, the update loop waits for each vsync like a renderer would
+static StepResult runStep(const std::vector<std::string>& files, int iPlayers, double dSeconds, int iSlots, int iFormat, double dSampleSeconds)
+{
+	StepResult step;
+	step.m_iPlayers = iPlayers;
+	step.m_iOpened = 0;
+	step.m_dSeconds = dSeconds;
+	step.m_lVsyncs = step.m_lLateVsyncs = step.m_lPresented = step.m_lDropped = 0;
+	step.m_dExpected = 0;
+	step.m_dIntervalMean = step.m_dIntervalStdDev = step.m_dIntervalP99 = step.m_dIntervalMax = 0;
+	step.m_dCpuPercent = step.m_dResidentMB = 0;
+
+	// the group is created first, so it outlives the players
+	PlayerGroup group(iSlots > 0 ? iSlots : 0);
+	std::vector<FFmpegWrapper*> players;
+	for(int i=0; i<iPlayers; i++)
+	{
+		FFmpegWrapper* pPlayer = new FFmpegWrapper();
+		pPlayer->setOutputFormat(s_Formats[iFormat]);
+		pPlayer->setSeekIndexEnabled(false);		// its thread would just add to the startup cost
+		pPlayer->setAudioSyncEnabled(false);		// nobody pulls the audio
+		if(iSlots >= 0)
+			group.add(pPlayer);
+		if(!pPlayer->open(files[i % files.size()]) || !pPlayer->hasVideo() || pPlayer->getFps() <= 0)
+		{
+			delete pPlayer;
+			continue;
+		}
+		pPlayer->setLoopMode(eLoop);
+		pPlayer->play();
+		players.push_back(pPlayer);
+	}
+	step.m_iOpened = (int)players.size();
+
+	std::vector<double> lastFrameTimes(players.size(), -1.0);
+	std::vector<double> intervals;		// relative to the frame duration of the player
+	std::vector<PlayerStats> startStats(players.size());
+	double dCpuStart = 0;
+	double dNextSample = 0;
+
+	boost::chrono::duration<double> vsync(1.0 / s_dVsyncRate);
+	boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+	boost::chrono::steady_clock::time_point measureStart = start + boost::chrono::duration_cast<boost::chrono::steady_clock::duration>(boost::chrono::duration<double>(1.0));
+	bool bMeasuring = false;
+	for(long lVsync = 1; ; lVsync++)
+	{
+		boost::chrono::steady_clock::time_point due = start + boost::chrono::duration_cast<boost::chrono::steady_clock::duration>(vsync * (double)lVsync);
+		boost::chrono::steady_clock::time_point now = boost::chrono::steady_clock::now();
+		if(now < due)
+			boost::this_thread::sleep_for(due - now);
+		else if(bMeasuring && now - due > vsync)
+			step.m_lLateVsyncs++;
+
+		if(!bMeasuring && due >= measureStart)
+		{
+			// warm up done, everything from here on counts
+			bMeasuring = true;
+			measureStart = due;
+			dCpuStart = getProcessCpuSeconds();
+			for(size_t i=0; i<players.size(); i++)
+			{
+				startStats[i] = players[i]->getStats();
+				lastFrameTimes[i] = -1.0;
+			}
+		}
+		double dTime = boost::chrono::duration<double>(due - measureStart).count();
+		if(bMeasuring && dTime >= dSeconds)
+			break;
+
+		for(size_t i=0; i<players.size(); i++)
+		{
+			if(!players[i]->isNewFrame() || !bMeasuring)
+				continue;
+			step.m_lPresented++;
+			if(lastFrameTimes[i] >= 0)
+				intervals.push_back((dTime - lastFrameTimes[i]) * players[i]->getFps());
+			lastFrameTimes[i] = dTime;
+		}
+		if(bMeasuring)
+		{
+			step.m_lVsyncs++;
+			if(dSampleSeconds > 0 && dTime >= dNextSample)
+			{
+				step.m_ResidentSamples.push_back(getResidentMegaBytes());
+				dNextSample += dSampleSeconds;
+			}
+		}
+	}
+
+	double dElapsed = getMilliSeconds(measureStart) / 1000.0;
+	step.m_dCpuPercent = (dElapsed > 0) ? (getProcessCpuSeconds() - dCpuStart) / dElapsed * 100.0 : 0;
+	step.m_dResidentMB = getResidentMegaBytes();
+	for(size_t i=0; i<players.size(); i++)
+	{
+		step.m_dExpected += dSeconds * players[i]->getFps();
+		step.m_lDropped += players[i]->getStats().m_lFramesDropped - startStats[i].m_lFramesDropped;
+	}
+
+	if(!intervals.empty())
+	{
+		double dSum = 0, dSquares = 0;
+		for(size_t i=0; i<intervals.size(); i++)
+		{
+			dSum += intervals[i];
+			dSquares += intervals[i] * intervals[i];
+		}
+		step.m_dIntervalMean = dSum / intervals.size();
+		step.m_dIntervalStdDev = sqrt(std::max(0.0, dSquares / intervals.size() - step.m_dIntervalMean * step.m_dIntervalMean));
+		std::sort(intervals.begin(), intervals.end());
+		step.m_dIntervalP99 = getPercentile(intervals, 99);
+		step.m_dIntervalMax = intervals.back();
+	}
+
+	for(size_t i=0; i<players.size(); i++)
+		delete players[i];
+	return step;
+}
+
+static bool parseCounts(const std::string& strList, std::vector<int>& counts)
+{
+	std::stringstream list(strList);
+	std::string strCount;
+	while(std::getline(list, strCount, ','))
+	{
+		int iCount = atoi(strCount.c_str());
+		if(iCount <= 0)
+			return false;
+		counts.push_back(iCount);
+	}
+	return !counts.empty();
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> files;
+	std::vector<int> counts;
+	std::string strJsonFile;
+	double dSeconds = 10;
+	double dSoakSeconds = 0;
+	int iSlots = 0;
+	int iFormat = 0;
+
+	for(int i=1; i<argc; i++)
+	{
+		std::string strArg = argv[i];
+		bool bHasValue = i + 1 < argc;
+		if(strArg == "--players" && bHasValue)
+		{
+			if(!parseCounts(argv[++i], counts))
+			{
+				std::cerr << "invalid player counts " << argv[i] << std::endl;
+				return 1;
+			}
+		}
+		else if(strArg == "--seconds" && bHasValue)
+			dSeconds = atof(argv[++i]);
+		else if(strArg == "--soak" && bHasValue)
+			dSoakSeconds = atof(argv[++i]);
+		else if(strArg == "--slots" && bHasValue)
+			iSlots = atoi(argv[++i]);
+		else if(strArg == "--format" && bHasValue)
+		{
+			iFormat = findName(s_FormatNames, 6, argv[++i]);
+			if(iFormat < 0)
+			{
+				std::cerr << "unknown format " << argv[i] << std::endl;
+				return 1;
+			}
+		}
+		else if(strArg == "--json" && bHasValue)
+			strJsonFile = argv[++i];
+		else if(strArg.compare(0, 2, "--") == 0)
+		{
+			std::cerr << "usage: soak [--players 1,2,4,...] [--seconds s] [--soak s] [--slots n] [--format name] [--json file] [files]" << std::endl;
+			return 1;
+		}
+		else
+			files.push_back(strArg);
+	}
+	if(files.empty())
+		files.push_back("data/morph.avi");
+	if(counts.empty())
+		parseCounts("1,2,4,8,16,32,64", counts);
+
+	std::vector<StepResult> steps;
+	for(size_t i=0; i<counts.size(); i++)
+	{
+		steps.push_back(runStep(files, counts[i], dSeconds, iSlots, iFormat, 0));
+		const StepResult& step = steps.back();
+		std::cerr << step.m_iOpened << "/" << step.m_iPlayers << " players, " << step.m_lPresented << " of " << (long)step.m_dExpected
+			<< " frames presented, " << step.m_dCpuPercent << "% cpu, " << step.m_dResidentMB << " MB" << std::endl;
+		if(step.m_iOpened == 0)
+		{
+			std::cerr << "none of the files can be opened" << std::endl;
+			return 2;
+		}
+	}
+
+	StepResult soak;
+	if(dSoakSeconds > 0)
+	{
+		soak = runStep(files, *std::max_element(counts.begin(), counts.end()), dSoakSeconds, iSlots, iFormat, 10.0);
+		std::cerr << "soak: " << soak.m_dResidentMB << " MB after " << dSoakSeconds << " s" << std::endl;
+	}
+
+	if(strJsonFile.empty())
+		writeJson(std::cout, steps, (dSoakSeconds > 0) ? &soak : nullptr);
+	else
+	{
+		std::ofstream out(strJsonFile.c_str());
+		if(!out)
+		{
+			std::cerr << "can't write " << strJsonFile << std::endl;
+			return 1;
+		}
+		writeJson(out, steps, (dSoakSeconds > 0) ? &soak : nullptr);
+	}
+	return 0;
+}
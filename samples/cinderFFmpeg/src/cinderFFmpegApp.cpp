@@ -28,6 +28,7 @@
 
 
 #include "_2RealFFmpegWrapper.h"
+#include "_2RealPlayerGroup.h"
 
 // cinder
 #include "cinder/app/AppBasic.h"
@@ -72,7 +73,9 @@ private:
 	static FMOD_RESULT F_CALLBACK pcmreadcallback(FMOD_SOUND *sound, void *data, unsigned int datalen);
 
 	static	cinderFFmpegApp*												m_Instance;
+	_2RealFFmpegWrapper::PlayerGroup										m_PlayerGroup;	// declared before the players, so it outlives them
 	std::vector<std::shared_ptr<_2RealFFmpegWrapper::FFmpegWrapper> >		m_Players;
+	std::vector<std::shared_ptr<_2RealFFmpegWrapper::FFmpegWrapper> >		m_OpeningPlayers;	// dropped files, moved to m_Players when opened
 	std::vector<ci::gl::Texture>											m_VideoTextures;
 	ci::params::InterfaceGl													m_Gui;
 	ci::Font																m_Font;
@@ -115,6 +118,10 @@ void cinderFFmpegApp::setup()
 
 	std::shared_ptr<_2RealFFmpegWrapper::FFmpegWrapper> testFile = std::shared_ptr<_2RealFFmpegWrapper::FFmpegWrapper>(new _2RealFFmpegWrapper::FFmpegWrapper());
 	testFile->dumpFFmpegInfo();
+	testFile->setAudioOutputFormat(_2RealFFmpegWrapper::eAudioS16, 44100, 2);	// what the fmod stream is set up for
+	testFile->setOutputFormat(_2RealFFmpegWrapper::eOutputBGRA);		// goes into the texture as it is
+	testFile->setOutputRowAlignment(4);
+	m_PlayerGroup.add(testFile.get());
 	//if(testFile->open(".\\data\\morph.avi"))
 	if(testFile->open("d:\\vjing\\Wildlife.wmv"))
 	{
@@ -152,6 +159,19 @@ void cinderFFmpegApp::setup()
 
 void cinderFFmpegApp::update()
 {
+	// take over the dropped files as soon as they are opened
+	for(int i=m_OpeningPlayers.size()-1; i>=0; i--)
+	{
+		if(m_OpeningPlayers[i]->isOpening())
+			continue;
+		if(m_OpeningPlayers[i]->waitForOpen())
+		{
+			m_Players.push_back(m_OpeningPlayers[i]);
+			m_VideoTextures.push_back(gl::Texture());
+		}
+		m_OpeningPlayers.erase(m_OpeningPlayers.begin() + i);
+	}
+
 	// set playing properties of current video
 	if(m_Players.size()<=0)
 		return;
@@ -187,10 +207,10 @@ void cinderFFmpegApp::draw()
 		if(m_Players[i]->hasVideo()) //&& m_Players[i]->isNewFrame())
 		{	
 		//	m_Players[i]->update();
-			unsigned char* pImg = m_Players[i]->getVideoData().m_pData;
-			if(pImg != nullptr)
+			_2RealFFmpegWrapper::VideoData& videoData = m_Players[i]->getVideoData();
+			if(videoData.m_pData != nullptr)
 			{		
-				m_VideoTextures[i] = gl::Texture(ci::Surface(pImg, m_Players[i]->getWidth(), m_Players[i]->getHeight(), m_Players[i]->getWidth() * 3, ci::SurfaceChannelOrder::RGB) );
+				m_VideoTextures[i] = gl::Texture(ci::Surface(videoData.m_pData, videoData.m_iWidth, videoData.m_iHeight, videoData.m_iLinesizes[0], ci::SurfaceChannelOrder::BGRA) );
 			}
 		}
 		posX = (i % m_iTilesDivisor) * m_iTileWidth;
@@ -222,6 +242,10 @@ void cinderFFmpegApp::open()
 	if( ! moviePath.empty() )
 	{
 		std::shared_ptr<_2RealFFmpegWrapper::FFmpegWrapper> fileToLoad = std::shared_ptr<_2RealFFmpegWrapper::FFmpegWrapper>(new _2RealFFmpegWrapper::FFmpegWrapper());
+		fileToLoad->setAudioOutputFormat(_2RealFFmpegWrapper::eAudioS16, 44100, 2);
+		fileToLoad->setOutputFormat(_2RealFFmpegWrapper::eOutputBGRA);
+		fileToLoad->setOutputRowAlignment(4);
+		m_PlayerGroup.add(fileToLoad.get());
 		if(fileToLoad->open(moviePath.string()))
 		{
 			m_Players.push_back(fileToLoad);
@@ -236,17 +260,20 @@ void cinderFFmpegApp::fileDrop( FileDropEvent event )
 	for(int i=0; i<event.getFiles().size(); i++)
 	{
 		std::shared_ptr<_2RealFFmpegWrapper::FFmpegWrapper> fileToLoad = std::shared_ptr<_2RealFFmpegWrapper::FFmpegWrapper>(new _2RealFFmpegWrapper::FFmpegWrapper());
-		if(fileToLoad->open(event.getFile(i).string()))
-		{
-			m_Players.push_back(fileToLoad);
-			m_VideoTextures.push_back(gl::Texture());
-			m_Players.back()->play();
-		}
+		fileToLoad->setAudioOutputFormat(_2RealFFmpegWrapper::eAudioS16, 44100, 2);
+		fileToLoad->setOutputFormat(_2RealFFmpegWrapper::eOutputBGRA);
+		fileToLoad->setOutputRowAlignment(4);
+		fileToLoad->setFastStartEnabled(true);
+		m_PlayerGroup.add(fileToLoad.get());
+		fileToLoad->openAsync(event.getFile(i).string());	// many files at once would block the ui for a long time otherwise
+		fileToLoad->play();
+		m_OpeningPlayers.push_back(fileToLoad);
 	}
 }
 
 void cinderFFmpegApp::clearAll()
 {
+	m_OpeningPlayers.clear();
 	m_Players.clear();
 	m_VideoTextures.clear();
 }
@@ -372,17 +399,14 @@ void cinderFFmpegApp::setupGui()
 
 FMOD_RESULT F_CALLBACK cinderFFmpegApp::pcmreadcallback(FMOD_SOUND *sound, void *data, unsigned int datalen)
 {
-  static long oldDts=-1;
-
-  _2RealFFmpegWrapper::AudioData audioData = m_Instance->m_Players[m_Instance->m_iCurrentVideo]->getAudioData();
- 
-	
-	int len = 2048*sizeof(short);
-	if(audioData.m_pData!=nullptr)
-		memcpy(data, audioData.m_pData, len);
-  
-	oldDts = audioData.m_lDts;
-    return FMOD_OK;
+	// pulls from the player's audio fifo, never blocks the sound card thread
+	std::shared_ptr<_2RealFFmpegWrapper::FFmpegWrapper> player = m_Instance->m_Players[m_Instance->m_iCurrentVideo];
+	int iBytesPerFrame = player->getAudioBytesPerFrame();
+	if(iBytesPerFrame > 0)
+		player->readAudio(data, datalen / iBytesPerFrame);
+	else
+		memset(data, 0, datalen);
+	return FMOD_OK;
 }
 
 void cinderFFmpegApp::audioCallback( uint64_t inSampleOffset, uint32_t ioSampleCount, audio::Buffer16u *ioBuffer ) 
@@ -0,0 +1,208 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This wrapper uses FFmpeg, and is licensed and credited as follows:
+
+	 * copyright (c) 2001 Fabrice Bellard
+	 *
+	 * This  FFmpeg.
+	 *
+	 * FFmpeg is free software; you can redistribute it and/or
+	 * modify it under the terms of the GNU Lesser General Public
+	 * License as published by the Free Software Foundation; either
+	 * version 2.1 of the License, or (at your option) any later version.
+	 *
+	 * FFmpeg is distributed in the hope that it will be useful,
+	 * but WITHOUT ANY WARRANTY; without even the implied warranty of
+	 * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	 * Lesser General Public License for more details.
+	 *
+	 * You should have received a copy of the GNU Lesser General Public
+	 * License along with FFmpeg; if not, write to the Free Software
+	 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA	 
+*/
+
+#include "_2RealAudioFifo.h"
+#include <cstring>
+
+namespace _2RealFFmpegWrapper
+{
+
+AudioFifo::AudioFifo() : m_iCapacity(0), m_iFrameSize(0), m_iWritePosition(0), m_iReadPosition(0), m_iFlushPosition(0), m_iReadCount(0), m_lUnderruns(0), m_lOverruns(0)
+{
+}
+
+void AudioFifo::allocate(int iFrames, int iFrameSize)
+{
+	m_iCapacity = 1;
+	while(m_iCapacity < (unsigned int)iFrames)
+		m_iCapacity <<= 1;
+	m_iFrameSize = (iFrameSize < 1) ? 1 : iFrameSize;
+	m_Buffer.assign(m_iCapacity * m_iFrameSize, 0);
+	m_iWritePosition = 0;
+	m_iReadPosition = 0;
+	m_iFlushPosition = 0;
+}
+
+// the reader skips to the flush position once it sees it, until then the writer has to take it into account too
+unsigned int AudioFifo::getReadPosition()
+{
+	unsigned int iRead = m_iReadPosition.load(boost::memory_order_acquire);
+	unsigned int iFlush = m_iFlushPosition.load(boost::memory_order_acquire);
+	return ((int)(iFlush - iRead) > 0) ? iFlush : iRead;
+}
+
+int AudioFifo::write(const unsigned char* pData, int iFrames)
+{
+	unsigned int iWrite = m_iWritePosition.load(boost::memory_order_relaxed);
+	int iFree = (int)(m_iCapacity - (iWrite - getReadPosition()));
+	if(iFrames > iFree)
+		iFrames = iFree;
+	if(iFrames <= 0)
+		return 0;
+
+	// in two parts if the ring wraps
+	unsigned int iOffset = iWrite & (m_iCapacity - 1);
+	int iFirst = (int)(m_iCapacity - iOffset);
+	if(iFirst > iFrames)
+		iFirst = iFrames;
+	memcpy(&m_Buffer[iOffset * m_iFrameSize], pData, iFirst * m_iFrameSize);
+	if(iFrames > iFirst)
+		memcpy(&m_Buffer[0], pData + iFirst * m_iFrameSize, (iFrames - iFirst) * m_iFrameSize);
+
+	m_iWritePosition.store(iWrite + iFrames, boost::memory_order_release);
+	return iFrames;
+}
+
+int AudioFifo::writePlanar(const unsigned char* const* pPlanes, int iChannels, int iFirstFrame, int iFrames)
+{
+	unsigned int iWrite = m_iWritePosition.load(boost::memory_order_relaxed);
+	int iFree = (int)(m_iCapacity - (iWrite - getReadPosition()));
+	if(iFrames > iFree)
+		iFrames = iFree;
+	if(iFrames <= 0 || iChannels <= 0)
+		return 0;
+
+	int iSampleSize = m_iFrameSize / iChannels;
+	for(int i=0; i<iFrames; i++)
+	{
+		unsigned char* pFrame = &m_Buffer[((iWrite + i) & (m_iCapacity - 1)) * m_iFrameSize];
+		for(int c=0; c<iChannels; c++)
+			memcpy(pFrame + c * iSampleSize, pPlanes[c] + (iFirstFrame + i) * iSampleSize, iSampleSize);
+	}
+
+	m_iWritePosition.store(iWrite + iFrames, boost::memory_order_release);
+	return iFrames;
+}
+
+void AudioFifo::drop(int iFrames)
+{
+	if(iFrames > 0)
+		m_lOverruns.fetch_add(iFrames, boost::memory_order_relaxed);
+}
+
+int AudioFifo::read(unsigned char* pData, int iFrames)
+{
+	m_iReadCount.fetch_add(1, boost::memory_order_relaxed);
+	if(m_iCapacity == 0)
+	{
+		memset(pData, 0, iFrames * m_iFrameSize);
+		return 0;
+	}
+
+	unsigned int iRead = getReadPosition();
+	unsigned int iWrite = m_iWritePosition.load(boost::memory_order_acquire);
+	int iAvailable = (int)(iWrite - iRead);
+	int iCount = (iFrames < iAvailable) ? iFrames : iAvailable;
+
+	unsigned int iOffset = iRead & (m_iCapacity - 1);
+	int iFirst = (int)(m_iCapacity - iOffset);
+	if(iFirst > iCount)
+		iFirst = iCount;
+	if(iFirst > 0)
+		memcpy(pData, &m_Buffer[iOffset * m_iFrameSize], iFirst * m_iFrameSize);
+	if(iCount > iFirst)
+		memcpy(pData + iFirst * m_iFrameSize, &m_Buffer[0], (iCount - iFirst) * m_iFrameSize);
+
+	if(iCount < iFrames)
+	{
+		memset(pData + iCount * m_iFrameSize, 0, (iFrames - iCount) * m_iFrameSize);
+		m_lUnderruns.fetch_add(iFrames - iCount, boost::memory_order_relaxed);
+	}
+	m_iReadPosition.store(iRead + iCount, boost::memory_order_release);
+
+	// drag the flush position along so it never ends up more than half the counter range behind
+	unsigned int iFlush = m_iFlushPosition.load(boost::memory_order_relaxed);
+	if(iFlush != iRead + iCount && (int)(iFlush - iRead) <= 0)
+		m_iFlushPosition.compare_exchange_strong(iFlush, iRead + iCount, boost::memory_order_release);
+	return iCount;
+}
+
+void AudioFifo::flush()
+{
+	m_iFlushPosition.store(m_iWritePosition.load(boost::memory_order_relaxed), boost::memory_order_release);
+}
+
+unsigned int AudioFifo::getWritePosition()
+{
+	return m_iWritePosition.load(boost::memory_order_acquire);
+}
+
+int AudioFifo::getBufferedFrames()
+{
+	return (int)(m_iWritePosition.load(boost::memory_order_acquire) - getReadPosition());
+}
+
+int AudioFifo::getFreeFrames()
+{
+	return (int)m_iCapacity - getBufferedFrames();
+}
+
+int AudioFifo::getCapacity()
+{
+	return (int)m_iCapacity;
+}
+
+int AudioFifo::getFrameSize()
+{
+	return m_iFrameSize;
+}
+
+unsigned int AudioFifo::getReadCount()
+{
+	return m_iReadCount.load(boost::memory_order_relaxed);
+}
+
+long AudioFifo::getUnderruns()
+{
+	return m_lUnderruns.load(boost::memory_order_relaxed);
+}
+
+long AudioFifo::getOverruns()
+{
+	return m_lOverruns.load(boost::memory_order_relaxed);
+}
+
+};
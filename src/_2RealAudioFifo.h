@@ -0,0 +1,70 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+*/
+
+#pragma once
+
+#include <vector>
+#include <boost/atomic.hpp>
+
+namespace _2RealFFmpegWrapper
+{
+	// single producer single consumer ring of interleaved audio sample frames, the decoder writes and the sound card
+	// callback reads, read() neither locks nor allocates so it is safe on a realtime thread
+	// positions are free running 32 bit counters, the capacity is a power of two so they wrap consistently
+	class AudioFifo
+	{
+	public:
+		AudioFifo();
+
+		void			allocate(int iFrames, int iFrameSize);		// while neither side is running
+		int				write(const unsigned char* pData, int iFrames);	// returns the frames which fit
+		int				writePlanar(const unsigned char* const* pPlanes, int iChannels, int iFirstFrame, int iFrames);	// interleaves on the way, starting at iFirstFrame of the planes
+		void			drop(int iFrames);							// counts frames the writer had to throw away
+		int				read(unsigned char* pData, int iFrames);	// missing frames are filled with silence, returns the frames read
+		void			flush();									// writer side, everything written so far is skipped by the reader
+		int				getBufferedFrames();
+		int				getFreeFrames();
+		int				getCapacity();
+		int				getFrameSize();
+		unsigned int	getReadCount();								// number of read() calls, tells the writer if anybody reads at all
+		long			getUnderruns();								// frames of silence handed out
+		long			getOverruns();								// frames dropped by the writer
+		unsigned int	getReadPosition();							// sample frames consumed so far, a flush counts as consumed
+		unsigned int	getWritePosition();
+
+	private:
+
+		std::vector<unsigned char>		m_Buffer;
+		unsigned int					m_iCapacity;		// in frames
+		int								m_iFrameSize;		// in bytes
+		boost::atomic<unsigned int>		m_iWritePosition;
+		boost::atomic<unsigned int>		m_iReadPosition;
+		boost::atomic<unsigned int>		m_iFlushPosition;
+		boost::atomic<unsigned int>		m_iReadCount;
+		boost::atomic<long>				m_lUnderruns;
+		boost::atomic<long>				m_lOverruns;
+	};
+};
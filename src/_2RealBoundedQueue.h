@@ -0,0 +1,164 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+*/
+
+#pragma once
+
+#include <vector>
+#include <boost/thread.hpp>
+
+namespace _2RealFFmpegWrapper
+{
+	// thread safe fifo with a fixed capacity, storage is a ring allocated once in setCapacity so push/pop never touch the heap
+	// push blocks while the queue is full, pop blocks while it is empty, both return false as soon as abort() was called
+	template <typename T>
+	class BoundedQueue
+	{
+	public:
+		BoundedQueue(int iCapacity = 1) : m_iHead(0), m_iCount(0), m_bAbort(false)
+		{
+			setCapacity(iCapacity);
+		}
+
+		// drops all queued items, so just call it while the queue is not in use
+		void setCapacity(int iCapacity)
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			if(iCapacity<1)
+				iCapacity = 1;
+			m_Items.assign(iCapacity, T());
+			m_iHead = m_iCount = 0;
+		}
+
+		int getCapacity()
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			return (int)m_Items.size();
+		}
+
+		bool push(const T& item)
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			while(!m_bAbort && m_iCount == (int)m_Items.size())
+				m_NotFull.wait(scopedLock);
+			if(m_bAbort)
+				return false;
+			pushUnlocked(item);
+			return true;
+		}
+
+		// non blocking, also works on an aborted queue so items can be recycled while shutting down
+		bool tryPush(const T& item)
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			if(m_iCount == (int)m_Items.size())
+				return false;
+			pushUnlocked(item);
+			return true;
+		}
+
+		bool pop(T& item)
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			while(!m_bAbort && m_iCount == 0)
+				m_NotEmpty.wait(scopedLock);
+			if(m_bAbort)
+				return false;
+			popUnlocked(item);
+			return true;
+		}
+
+		// non blocking, also works on an aborted queue so it can be used for draining
+		bool tryPop(T& item)
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			if(m_iCount == 0)
+				return false;
+			popUnlocked(item);
+			return true;
+		}
+
+		// looks at the next item without removing it
+		bool tryPeek(T& item)
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			if(m_iCount == 0)
+				return false;
+			item = m_Items[m_iHead];
+			return true;
+		}
+
+		// wakes up all waiting threads, every following blocking call returns false until reset() is called
+		void abort()
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			m_bAbort = true;
+			m_NotEmpty.notify_all();
+			m_NotFull.notify_all();
+		}
+
+		void reset()
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			m_bAbort = false;
+		}
+
+		int size()
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			return m_iCount;
+		}
+
+		bool isEmpty()
+		{
+			return size() == 0;
+		}
+
+	private:
+		void pushUnlocked(const T& item)
+		{
+			m_Items[(m_iHead + m_iCount) % m_Items.size()] = item;
+			m_iCount++;
+			m_NotEmpty.notify_one();
+		}
+
+		void popUnlocked(T& item)
+		{
+			item = m_Items[m_iHead];
+			m_Items[m_iHead] = T();
+			m_iHead = (m_iHead + 1) % m_Items.size();
+			m_iCount--;
+			m_NotFull.notify_one();
+		}
+
+		std::vector<T>				m_Items;
+		int							m_iHead;
+		int							m_iCount;
+		bool						m_bAbort;
+		boost::mutex				m_Mutex;
+		boost::condition_variable	m_NotEmpty;
+		boost::condition_variable	m_NotFull;
+	};
+};
@@ -45,6 +45,19 @@
 */
 
 #include "_2RealFFmpegWrapper.h"
+#include "_2RealPlayerGroup.h"
+#include "_2RealPlayerStats.h"
+#include "_2RealBoundedQueue.h"
+#include "_2RealFramePool.h"
+#include "_2RealScalerCache.h"
+#include "_2RealSeekIndex.h"
+#include "_2RealFrameCache.h"
+#include "_2RealAudioFifo.h"
+#include "_2RealMappedFile.h"
+#include "_2RealStreamInfoCache.h"
+#include "_2RealPacketPool.h"
+#include "_2RealPixelConverter.h"
+#include <algorithm>
 #include <iostream>
 
 // ffmpeg includes
@@ -56,28 +69,138 @@ extern "C" {
 	#include "libavutil/avutil.h"
 	#include "libswscale/swscale.h"
 	#include "libavutil/rational.h"
+	#include "libavutil/samplefmt.h"
+	#include "libavutil/audioconvert.h"
+	#include "libswresample/swresample.h"
 	//#include "libavutil/opt.h"
 }
 
 #define EPS 0.000025	// epsilon for checking unsual results as taken from OpenCV FFmeg player
+#define KEYFRAMES_ONLY_SPEED 8.0	// from this speed on just keyframes are decoded
+#define IO_BUFFER_SIZE 32768		// for the io context of input sources
 namespace _2RealFFmpegWrapper
 {
 
-FFmpegWrapper::FFmpegWrapper() : m_bIsInitialized(false)
+// what the demuxer thread hands to the decoder threads, flush and drain commands travel in order with the packets
+enum {ePacketData, ePacketFlush, ePacketDrain, ePacketFinished, ePacketCached};
+
+struct QueuedPacket
 {
-	init();
+	AVPacket*		m_pPacket;				// just set for ePacketData
+	int				m_iCommand;
+	int				m_iSerial;				// seek serial at demux time, packets of older serials are skipped
+	long			m_lTargetFrame;			// ePacketFlush: first frame to output after a seek, ePacketCached: first frame to queue
+	long			m_lLastFrame;			// ePacketFlush: last frame of a backward segment, -1 when playing forward, ePacketCached: last frame to queue
+};
+
+static const boost::int64_t s_lNoPts = (boost::int64_t)AV_NOPTS_VALUE;	// AV_NOPTS_VALUE itself is unsigned, compared with signed timestamps
+
+// decoder threads are shared between all players, so several players don't each start one thread per core
+static boost::mutex	s_ThreadBudgetMutex;
+static int			s_iDefaultDecoderThreads = 0;
+static int			s_iDefaultDecoderThreadType = eThreadAuto;
+static int			s_iDecoderCoreBudget = 0;
+static int			s_iDecoderThreadsInUse = 0;
+
+static boost::mutex	s_CacheMutex;
+static std::string	s_strSeekIndexCacheDirectory;
+
+static int getCoreBudget()
+{
+	if(s_iDecoderCoreBudget > 0)
+		return s_iDecoderCoreBudget;
+	int iCores = (int)boost::thread::hardware_concurrency();
+	return (iCores < 1) ? 1 : iCores;
 }
 
+static void releaseFrames(std::vector<VideoFrame*>& frames)
+{
+	for(size_t i=0; i<frames.size(); i++)
+		FramePool::release(frames[i]);
+	frames.clear();
+}
 
-FFmpegWrapper::FFmpegWrapper(std::string strFileName) : m_bIsInitialized(false) 
+static int readInputSource(void* pOpaque, uint8_t* pBuffer, int iSize)
 {
-	init();
+	int iRead = ((InputSource*)pOpaque)->read(pBuffer, iSize);
+	if(iRead == 0)
+		return AVERROR_EOF;
+	return (iRead < 0) ? AVERROR(EIO) : iRead;
+}
+
+static int64_t seekInputSource(void* pOpaque, int64_t lOffset, int iWhence)
+{
+	InputSource* pSource = (InputSource*)pOpaque;
+	if(iWhence == AVSEEK_SIZE)
+		return pSource->getSize();
+	return pSource->seek(lOffset, iWhence & ~AVSEEK_FORCE);
+}
+
+FFmpegWrapper::FFmpegWrapper()
+{
+	initSettings();
+}
+
+FFmpegWrapper::FFmpegWrapper(std::string strFileName)
+{
+	initSettings();
 	open(strFileName);
 }
 
+// defaults of the settings and the objects living as long as the player, shared by both constructors
+void FFmpegWrapper::initSettings()
+{
+	m_pGroup = nullptr;
+	m_iFrameQueueDepth = 4;
+	m_iOutputFormat = eOutputRGB24;
+	m_iOutputWidth = 0;
+	m_iOutputHeight = 0;
+	m_iOutputScaler = eScaleBicubic;
+	m_iOutputRowAlignment = 0;
+	m_iPacketQueueDepth = 64;
+	m_iBackwardCacheFrames = 30;
+	m_iFrameCacheSize = 0;
+	m_iAudioBufferSize = 4000;
+	m_iReadAheadHint = eReadAheadSequential;
+	m_iReadAheadWindow = 4096;
+	m_iProbeSize = 0;
+	m_iAnalyzeDuration = 0;
+	m_iAudioOutputFormat = eAudioNative;
+	m_iAudioOutputSampleRate = 0;
+	m_iAudioOutputChannels = 0;
+	m_bAudioSync = true;
+	m_bRealtime = true;
+	m_dAudioLatencyInMs = 0;
+	m_iDecoderThreads = 0;
+	m_iDecoderThreadType = eThreadAuto;
+	m_bIsInitialized = false;
+	m_bSeekIndexEnabled = false;
+	m_bVisible = true;
+	m_bFileMapping = sizeof(void*) >= 8;		// a mapping takes the whole file size of address space
+	m_bFastStart = false;
+	m_bOpening = false;
+	m_bAbortOpen = false;
+	m_bPlayAfterOpen = false;
+
+	m_pReadyFrames = new BoundedQueue<VideoFrame*>();
+	m_pVideoPackets = new BoundedQueue<QueuedPacket>();
+	m_pAudioPackets = new BoundedQueue<QueuedPacket>();
+	m_pCounters = new PlayerCounters();
+	m_pPacketPool = new PacketPool(2 * m_iPacketQueueDepth + 4);
+	init();
+	initPropertyVariables();
+}
+
 FFmpegWrapper::~FFmpegWrapper() 
 {
 	close();
+	if(m_pGroup != nullptr)
+		m_pGroup->remove(this);
+	delete m_pReadyFrames;
+	delete m_pVideoPackets;
+	delete m_pAudioPackets;
+	delete m_pCounters;
+	delete m_pPacketPool;
 }
 
 bool FFmpegWrapper::init()
@@ -95,20 +218,59 @@ void FFmpegWrapper::initPropertyVariables()
 {
 	// init property variables
 	m_bIsFileOpen = false;
+	m_bFastStarted = false;
+	m_pCounters->reset();
 	m_bIsThreadRunning = false; 
 	m_pFormatContext = nullptr;
+	m_pMappedFile = nullptr;
+	m_pInputSource = nullptr;
+	m_pIOContext = nullptr;
 	m_pVideoCodecContext = nullptr;
 	m_pAudioCodecContext = nullptr;
-	m_pSwScalingContext = nullptr;
 	m_pVideoFrame = nullptr;
-	m_pVideoFrameRGB = nullptr;
-	m_pVideoBuffer = nullptr;
 	m_pAudioFrame = nullptr;
+	m_pScalerCache = nullptr;
+	m_pSeekIndex = nullptr;
+	m_pFrameCache = nullptr;
+	m_pAudioFifo = nullptr;
+	m_pResampler = nullptr;
+	m_iAudioFifoFormat = AV_SAMPLE_FMT_NONE;
+	m_iAudioFifoSampleRate = 0;
+	m_iAudioFifoChannels = 0;
+	m_iResampleInFormat = -1;
+	m_iResampleInSampleRate = 0;
+	m_lResampleInLayout = 0;
+	m_bResampleAudio = false;
+	m_bAudioSyncActive = false;
+	m_bAudioClockValid = false;
+	m_iAudioClockPosition = 0;
+	m_dAudioClockTime = 0;
+	m_iAudioClockSerial = -1;
+	m_iLastAudioReadCount = 0;
+	m_lAudioClockFrame.store(-1, boost::memory_order_relaxed);
+	m_bVideoBehindAudio.store(false, boost::memory_order_relaxed);
+	m_dAudioVideoDrift = 0;
+	m_dMaxAudioVideoDrift = 0;
+	m_bSeekIndexApplied = false;
+	m_bSeekDeferred = false;
+	m_iReservedThreads = 0;
+	m_iSerial = 0;
+	m_iPrerollFrames = 0;
+	m_lSeekTargetFrame = 0;
+	m_bSeekRequested = false;
+	m_bFrameRequested = true;
+	m_bEndOfStream = false;
+	m_bDemuxFinished = false;
+	m_iVideoStream = m_iAudioStream = -1;
 	
 	m_iLoopMode = eLoop;
 	m_dTargetTimeInMs = 0;
 	m_lCurrentFrameNumber = -1;	// set to invalid, as it is not decoded yet
 	m_dCurrentTimeInMs = -1;	// set to invalid, as it is not decoded yet
+	m_dFramesDue = 0;
+	m_lLastScheduledFrame = -1;
+	m_lLastOutputFrame = -1;
+	m_bNewFrame = false;
 	m_fSpeedMultiplier = 1.0;
 	m_dFps = 0;
 	m_iBitrate = 0;
@@ -117,6 +279,7 @@ void FFmpegWrapper::initPropertyVariables()
 	m_iDirection = eForward;
 	m_iState = eStopped;
 	m_lFramePosInPreLoadedFile = 0;
+	publishDecodeSchedule();
 
 	m_AVData.m_VideoData.m_iWidth = 0;
 	m_AVData.m_VideoData.m_iHeight = 0;
@@ -124,6 +287,12 @@ void FFmpegWrapper::initPropertyVariables()
 	m_AVData.m_VideoData.m_lPts = 0;
 	m_AVData.m_VideoData.m_lDts = 0;
 	m_AVData.m_VideoData.m_iChannels = 0;
+	m_AVData.m_VideoData.m_iPixelFormat = PIX_FMT_NONE;
+	for(int i=0; i<4; i++)
+	{
+		m_AVData.m_VideoData.m_pPlanes[i] = nullptr;
+		m_AVData.m_VideoData.m_iLinesizes[i] = 0;
+	}
 
 	m_AVData.m_AudioData.m_iChannels = 0;
 	m_AVData.m_AudioData.m_iSampleRate = 0;
@@ -135,22 +304,142 @@ void FFmpegWrapper::initPropertyVariables()
 
 bool FFmpegWrapper::open(std::string strFileName)
 {
+	close();	// also cleans up what a previously failed open left behind
 	initPropertyVariables();
-	m_strFileName = strFileName;
+	return openFile(strFileName);
+}
 
-	if(m_bIsFileOpen)
+void FFmpegWrapper::openAsync(std::string strFileName, OpenCallback callback)
+{
+	close();
+	initPropertyVariables();	// here, the getters may be called while the open thread runs
+	{
+		boost::mutex::scoped_lock scopedLock(m_OpenMutex);
+		m_bOpening = true;
+		m_bPlayAfterOpen = false;
+	}
+	m_OpenThread = boost::thread(&FFmpegWrapper::threadedOpen, this, strFileName, callback);
+}
+
+bool FFmpegWrapper::isOpening()
+{
+	boost::mutex::scoped_lock scopedLock(m_OpenMutex);
+	return m_bOpening;
+}
+
+bool FFmpegWrapper::waitForOpen()
+{
+	if(m_OpenThread.joinable())
+		m_OpenThread.join();
+	return m_bIsFileOpen;
+}
+
+void FFmpegWrapper::threadedOpen(std::string strFileName, OpenCallback callback)
+{
+	bool bOpened = openFile(strFileName);
+	bool bAborted = m_bAbortOpen;
+	bool bPlay = false;
+	{
+		boost::mutex::scoped_lock scopedLock(m_OpenMutex);
+		bPlay = m_bPlayAfterOpen;
+		m_bPlayAfterOpen = false;
+	}
+	// still flagged as opening, so a concurrent play() doesn't start the threads twice
+	if(bOpened && bPlay && !bAborted)
+		startPlayback();
+	{
+		boost::mutex::scoped_lock scopedLock(m_OpenMutex);
+		m_bOpening = false;
+	}
+	if(!bAborted && !callback.empty())
+		callback(this, bOpened);
+}
+
+// interrupt callback of the format context, lets close() stop an open that is probing or waiting for the network
+int FFmpegWrapper::isOpenAborted(void* pOpaque)
+{
+	FFmpegWrapper* pPlayer = (FFmpegWrapper*)pOpaque;
+	return pPlayer->m_bAbortOpen ? 1 : 0;
+}
+
+// the property variables are reset by the caller, on the calling thread
+bool FFmpegWrapper::openFile(const std::string& strFileName)
+{
+
+	// local files are read through a memory mapping, urls or files which can't be mapped use ffmpeg's protocols
+	bool bIsLocalFile = MappedFile::isLocalFile(strFileName);
+	if(m_bFileMapping && bIsLocalFile)
+		openMappedFile(strFileName);
+	return openInput(strFileName, bIsLocalFile, bIsLocalFile);
+}
+
+bool FFmpegWrapper::open(const unsigned char* pData, boost::int64_t lSize, std::string strName)
+{
+	close();
+	initPropertyVariables();
+	if(pData == nullptr || lSize <= 0)
+		return false;
+
+	// read like a mapped file, so the seek index can have a reader of its own too, there's no file to cache it for
+	m_pMappedFile = new MappedFile();
+	m_pMappedFile->attach(pData, lSize);
+	m_pIOContext = m_pMappedFile->createIOContext();
+	return m_pIOContext != nullptr && openInput(strName, true, false);
+}
+
+bool FFmpegWrapper::open(InputSource* pSource, std::string strName)
+{
+	close();
+	initPropertyVariables();
+	if(pSource == nullptr)
+		return false;
+
+	unsigned char* pBuffer = (unsigned char*)av_malloc(IO_BUFFER_SIZE);
+	if(pBuffer == nullptr)
+		return false;
+	AVIOContext* pIOContext = avio_alloc_context(pBuffer, IO_BUFFER_SIZE, 0, pSource, readInputSource, nullptr, seekInputSource);
+	if(pIOContext == nullptr)
 	{
-		stop();
-		close();
+		av_free(pBuffer);
+		return false;
 	}
+	pIOContext->seekable = (pSource->getSize() >= 0) ? AVIO_SEEKABLE_NORMAL : 0;
+	m_pInputSource = pSource;
+	m_pIOContext = pIOContext;
+	return openInput(strName, false, false);		// the source has just one reader, the player's
+}
+
+// opens the demuxer on the io context set up by open(), or on the file name itself if there is none
+// bCanIndex .. the input can be read a second time for the seek index, bCanCache .. the name is a local file, so the
+// stream info and the index may be cached on disk for it
+bool FFmpegWrapper::openInput(const std::string& strName, bool bCanIndex, bool bCanCache)
+{
+	m_strFileName = strName;
+	m_pFormatContext = avformat_alloc_context();
+	if(m_pFormatContext == nullptr)
+		return false;
+	m_pFormatContext->pb = (AVIOContext*)m_pIOContext;
+	m_pFormatContext->interrupt_callback.callback = isOpenAborted;
+	m_pFormatContext->interrupt_callback.opaque = this;
+	if(m_iProbeSize > 0)
+		m_pFormatContext->probesize = m_iProbeSize;
+	if(m_iAnalyzeDuration > 0)
+		m_pFormatContext->max_analyze_duration = (int)((boost::int64_t)m_iAnalyzeDuration * AV_TIME_BASE / 1000);
 
 	// Open video file
-	if(avformat_open_input(&m_pFormatContext, strFileName.c_str(), NULL, NULL)!=0)
+	if(avformat_open_input(&m_pFormatContext, strName.c_str(), NULL, NULL)!=0)
 	   return false; // couldn't open file
 
-	// Retrieve stream information
-	if(av_find_stream_info(m_pFormatContext)<0)
-		return false; // couldn't find stream information
+	// Retrieve stream information, with fast start from the cache if the header announces the streams known from the last time
+	bool bUseCache = bCanCache && m_bFastStart;
+	m_bFastStarted = bUseCache && StreamInfoCache::apply(strName, m_pFormatContext, getSeekIndexCacheDirectory());
+	if(!m_bFastStarted)
+	{
+		if(av_find_stream_info(m_pFormatContext)<0)
+			return false; // couldn't find stream information
+		if(bUseCache)
+			StreamInfoCache::store(strName, m_pFormatContext, getSeekIndexCacheDirectory());
+	}
 
 	// Find the first video stream
 	m_iVideoStream = m_iAudioStream = -1;
@@ -185,7 +474,6 @@ bool FFmpegWrapper::open(std::string strFileName)
 	retrieveFileInfo();
 
 	m_bIsFileOpen = true;
-	m_strFileName = strFileName;
 
 	// content is image, just decode once 
 	if(isImage())
@@ -195,13 +483,33 @@ bool FFmpegWrapper::open(std::string strFileName)
 		m_lCurrentFrameNumber = 1;
 		decodeImage();
 	}
+	else if(hasVideo() && m_bSeekIndexEnabled && bCanIndex && m_pFormatContext->pb != nullptr && m_pFormatContext->pb->seekable)
+	{
+		// the index reads the whole input a second time, so sources and urls are left out, a live stream would never finish
+		m_pSeekIndex = new SeekIndex();
+		m_pSeekIndex->startBuilding(strName, m_iVideoStream, m_dFps, bCanCache ? getSeekIndexCacheDirectory() : std::string(), m_pMappedFile);
+		applySeekIndexInfo();	// a cached index is complete right away
+	}
 
 	// start timer
-	m_OldTime = boost::chrono::system_clock::now();
+	m_OldTime = boost::chrono::steady_clock::now();
 
 	return m_bIsFileOpen;
 }
 
+bool FFmpegWrapper::openMappedFile(const std::string& strFileName)
+{
+	m_pMappedFile = new MappedFile();
+	if(m_pMappedFile->open(strFileName, m_iReadAheadHint, m_iReadAheadWindow * 1024))
+		m_pIOContext = m_pMappedFile->createIOContext();
+	if(m_pIOContext != nullptr)
+		return true;
+
+	delete m_pMappedFile;
+	m_pMappedFile = nullptr;
+	return false;
+}
+
 bool FFmpegWrapper::openVideoStream()
 {
 	// Get a pointer to the codec context for the video stream
@@ -212,31 +520,20 @@ bool FFmpegWrapper::openVideoStream()
 	if(pCodec==NULL)
 		return false; // Codec not found
 
-	// Open codec
-	AVDictionary* options;	
+	// Open codec with its share of the decoder threads
+	reserveDecoderThreads();
 	if(avcodec_open2(m_pVideoCodecContext, pCodec, nullptr)<0)
 		return false; // Could not open codec
 
 	// Allocate video frame
 	m_pVideoFrame = avcodec_alloc_frame();
-
-	// Allocate an AVFrame structure
-	m_pVideoFrameRGB=avcodec_alloc_frame();
-	if(m_pVideoFrameRGB==nullptr)
+	if(m_pVideoFrame==nullptr)
 		return false;
 
 	retrieveVideoInfo();
 
-	// Determine required buffer size and allocate buffer
-	m_pVideoBuffer=new uint8_t[ avpicture_get_size( PIX_FMT_RGB24, getWidth(), getHeight())];
-
-	// Assign appropriate parts of buffer to image planes in pFrameRGB
-	avpicture_fill((AVPicture*)m_pVideoFrameRGB, m_pVideoBuffer, PIX_FMT_RGB24, getWidth(), getHeight());
-	 
-	//Initialize Context
-	m_pSwScalingContext = sws_getContext(getWidth(), getHeight(), m_pVideoCodecContext->pix_fmt, getWidth(), getHeight(), PIX_FMT_RGB24, SWS_BICUBIC, NULL, NULL, NULL);
-
-	return true;
+	// Allocate the frames the video decoder converts into and the scaling context for them
+	return allocateVideoFrames();
 }
 
 bool FFmpegWrapper::openAudioStream()
@@ -249,8 +546,8 @@ bool FFmpegWrapper::openAudioStream()
 	if(pCodec==NULL)
 		return false; // Codec not found
 
-	// Open codec
-	AVDictionary* options;	
+	// Open codec, audio decoding is cheap compared to video, so it doesn't take from the core budget
+	m_pAudioCodecContext->thread_count = 1;
 	if(avcodec_open2(m_pAudioCodecContext, pCodec, nullptr)<0)
 		return false; // Could not open codec
 
@@ -259,24 +556,172 @@ bool FFmpegWrapper::openAudioStream()
 
 	retrieveAudioInfo();
 
+	// the output spec for readAudio, the resampler is only used if it differs from what the decoder delivers
+	m_iAudioFifoSampleRate = (m_iAudioOutputSampleRate > 0) ? m_iAudioOutputSampleRate : m_pAudioCodecContext->sample_rate;
+	m_iAudioFifoChannels = (m_iAudioOutputChannels > 0) ? m_iAudioOutputChannels : m_pAudioCodecContext->channels;
+	switch(m_iAudioOutputFormat)
+	{
+		case eAudioS16:		m_iAudioFifoFormat = AV_SAMPLE_FMT_S16;		break;
+		case eAudioFloat:	m_iAudioFifoFormat = AV_SAMPLE_FMT_FLT;		break;
+		default:			m_iAudioFifoFormat = m_pAudioCodecContext->sample_fmt;	break;	// planar is interleaved by the fifo
+	}
+	m_bResampleAudio = m_iAudioFifoSampleRate != m_pAudioCodecContext->sample_rate || m_iAudioFifoChannels != m_pAudioCodecContext->channels || (m_iAudioOutputFormat != eAudioNative && m_iAudioFifoFormat != m_pAudioCodecContext->sample_fmt);
+	if(m_bResampleAudio && m_iAudioOutputFormat == eAudioNative)
+		m_iAudioFifoFormat = av_get_packed_sample_fmt((AVSampleFormat)m_iAudioFifoFormat);
+	m_iResampleInFormat = -1;
+
+	// audio is decoded ahead of the video by the packet interleaving of the file, the fifo has to hold that much
+	int iFrameSize = m_iAudioFifoChannels * av_get_bytes_per_sample((AVSampleFormat)m_iAudioFifoFormat);
+	AudioFifo* pAudioFifo = new AudioFifo();
+	pAudioFifo->allocate((int)((boost::int64_t)m_iAudioFifoSampleRate * m_iAudioBufferSize / 1000), iFrameSize);
+	boost::mutex::scoped_lock scopedLock(m_Mutex);		// getStats may look at it from any thread
+	m_pAudioFifo = pAudioFifo;
+
 	return true;
 }
 
-void FFmpegWrapper::close()
+bool FFmpegWrapper::allocateVideoFrames()
 {
-	stop();
+	// queue depth plus the frame currently handed out plus the one the video decoder is converting into,
+	// some more are allocated on demand if the application keeps handles to older frames or plays backwards
+	int iFrames = m_iFrameQueueDepth + 2;
+	m_pReadyFrames->setCapacity(m_iFrameQueueDepth);
+	boost::int64_t lFrameCacheBytes = (boost::int64_t)m_iFrameCacheSize * 1024 * 1024;
+	if(lFrameCacheBytes > 0)
+	{
+		FrameCache* pFrameCache = new FrameCache(lFrameCacheBytes);
+		boost::mutex::scoped_lock scopedLock(m_Mutex);		// getStats may look at it from any thread
+		m_pFrameCache = pFrameCache;
+	}
+	m_pScalerCache = new ScalerCache(4, iFrames, iFrames + 4 + 2 * m_iBackwardCacheFrames, lFrameCacheBytes);
+
+	// set up the requested output right away, so the first decoded frame doesn't have to wait for any allocation
+	int iWidth, iHeight, iPixelFormat, iFlags, iRowAlignment;
+	getOutputSpec(iWidth, iHeight, iPixelFormat, iFlags, iRowAlignment);
+	SwsContext* pContext = nullptr;
+	PixelConverter::Function pConvert = nullptr;
+	FramePool* pPool = nullptr;
+	if(!m_pScalerCache->select(getSourceWidth(), getSourceHeight(), m_pVideoCodecContext->pix_fmt, iWidth, iHeight, iPixelFormat, iFlags, iRowAlignment, pContext, pConvert, pPool))
+		return false;
+
+	m_AVData.m_VideoData.m_iWidth = iWidth;
+	m_AVData.m_VideoData.m_iHeight = iHeight;
+	m_AVData.m_VideoData.m_iPixelFormat = iPixelFormat;
+	m_AVData.m_VideoData.m_iChannels = getChannelCount(iPixelFormat);
+	return true;
+}
 
-	// Free the RGB image
-	if(m_pVideoBuffer!=nullptr)
+void FFmpegWrapper::getOutputSpec(int& iWidth, int& iHeight, int& iPixelFormat, int& iFlags, int& iRowAlignment)
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	iRowAlignment = m_iOutputRowAlignment;
+	iWidth = (m_iOutputWidth > 0) ? m_iOutputWidth : getSourceWidth();
+	iHeight = (m_iOutputHeight > 0) ? m_iOutputHeight : getSourceHeight();
+
+	switch(m_iOutputFormat)
+	{
+		case eOutputNative:	iPixelFormat = m_pVideoCodecContext->pix_fmt;	break;
+		case eOutputBGRA:	iPixelFormat = PIX_FMT_BGRA;	break;
+		case eOutputRGBA:	iPixelFormat = PIX_FMT_RGBA;	break;
+		case eOutputGray8:	iPixelFormat = PIX_FMT_GRAY8;	break;
+		case eOutputNV12:	iPixelFormat = PIX_FMT_NV12;	break;
+		default:			iPixelFormat = PIX_FMT_RGB24;	break;
+	}
+	// native formats without a plain memory layout (hardware, paletted) have to be converted anyway
+	if(avpicture_get_size((PixelFormat)iPixelFormat, iWidth, iHeight) <= 0)
+		iPixelFormat = PIX_FMT_RGB24;
+
+	switch(m_iOutputScaler)
+	{
+		case eScaleFastBilinear:	iFlags = SWS_FAST_BILINEAR;	break;
+		case eScaleBilinear:		iFlags = SWS_BILINEAR;		break;
+		case eScalePoint:			iFlags = SWS_POINT;			break;
+		case eScaleArea:			iFlags = SWS_AREA;			break;
+		default:					iFlags = SWS_BICUBIC;		break;
+	}
+}
+
+void FFmpegWrapper::reserveDecoderThreads()
+{
+	boost::mutex::scoped_lock scopedLock(s_ThreadBudgetMutex);
+	int iThreads = (m_iDecoderThreads > 0) ? m_iDecoderThreads : s_iDefaultDecoderThreads;
+	int iThreadType = (m_iDecoderThreadType != eThreadAuto) ? m_iDecoderThreadType : s_iDefaultDecoderThreadType;
+	int iAvailable = getCoreBudget() - s_iDecoderThreadsInUse;
+	if(iThreads <= 0 || iThreads > iAvailable)
+		iThreads = iAvailable;
+	if(m_pGroup != nullptr && m_iDecoderThreads <= 0)
+		iThreads = 1;		// the group's slots let several players decode in parallel instead
+	if(iThreads < 1)
+		iThreads = 1;		// an exhausted budget still decodes, just without additional threads
+
+	m_iReservedThreads = iThreads;
+	s_iDecoderThreadsInUse += iThreads;
+	m_pVideoCodecContext->thread_count = iThreads;
+	if(iThreadType != eThreadAuto)
+		m_pVideoCodecContext->thread_type = iThreadType;
+}
+
+void FFmpegWrapper::releaseDecoderThreads()
+{
+	boost::mutex::scoped_lock scopedLock(s_ThreadBudgetMutex);
+	s_iDecoderThreadsInUse -= m_iReservedThreads;
+	m_iReservedThreads = 0;
+}
+
+// the finished index knows the exact length, which the container header often just estimates
+void FFmpegWrapper::applySeekIndexInfo()
+{
+	if(m_pSeekIndex == nullptr || !m_pSeekIndex->isComplete())
+		return;
+
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_bSeekIndexApplied = true;
+	if(m_pSeekIndex->getFrameCount() > 0)
+		m_lDurationInFrames = m_pSeekIndex->getFrameCount();
+	if(m_pSeekIndex->getDurationInMs() > 0)
+		m_dDurationInMs = m_pSeekIndex->getDurationInMs();
+}
+
+void FFmpegWrapper::freeVideoFrames()
+{
+	flushReadyFrames();
+	m_AVData.m_VideoData.m_Frame.reset();
+	m_AVData.m_VideoData.m_pData = nullptr;
+	for(int i=0; i<4; i++)
+		m_AVData.m_VideoData.m_pPlanes[i] = nullptr;
+	// taken out under the mutex, so getStats never sees a deleted one
+	FrameCache* pFrameCache = nullptr;
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		std::swap(pFrameCache, m_pFrameCache);
+	}
+	delete pFrameCache;
+	if(m_pScalerCache != nullptr)
+	{
+		delete m_pScalerCache;		// frames still referenced by the application are freed when released
+		m_pScalerCache = nullptr;
+	}
+}
+
+void FFmpegWrapper::close()
+{
+	// an async open is interrupted where ffmpeg checks for it, otherwise it is waited for
+	if(m_OpenThread.joinable())
 	{
-		delete m_pVideoBuffer;
-		m_pVideoBuffer = nullptr;
+		m_bAbortOpen = true;
+		m_OpenThread.join();
+		m_bAbortOpen = false;
 	}
 
-	if(m_pVideoFrameRGB!=nullptr)
+	stop();
+
+	// Free the RGB images
+	freeVideoFrames();
+
+	if(m_pSeekIndex!=nullptr)
 	{
-		av_free(m_pVideoFrameRGB);
-		m_pVideoFrameRGB = nullptr;
+		delete m_pSeekIndex;	// waits for the index thread
+		m_pSeekIndex = nullptr;
 	}
 
 	// Free the YUV frame
@@ -292,12 +737,18 @@ void FFmpegWrapper::close()
 		m_pAudioFrame = nullptr;
 	}
 
-
-	if(m_pSwScalingContext!=nullptr)
+	// the application must not call readAudio any more, getStats doesn't get to see it deleted
+	AudioFifo* pAudioFifo = nullptr;
 	{
-		sws_freeContext(m_pSwScalingContext);
-		m_pSwScalingContext = nullptr;
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		std::swap(pAudioFifo, m_pAudioFifo);
 	}
+	delete pAudioFifo;
+
+	if(m_pResampler!=nullptr)
+		swr_free(&m_pResampler);
+	m_ResampleBuffer.clear();
+
 
 	// Close the codecs
 	if(m_pVideoCodecContext!=nullptr)
@@ -305,6 +756,7 @@ void FFmpegWrapper::close()
 		avcodec_close(m_pVideoCodecContext);
 		m_pVideoCodecContext = nullptr;
 	}
+	releaseDecoderThreads();
 	if(m_pAudioCodecContext!=nullptr)
 	{
 		avcodec_close(m_pAudioCodecContext);
@@ -318,254 +770,1468 @@ void FFmpegWrapper::close()
 		avformat_free_context(m_pFormatContext);	// this line should free all the associated mem with file, todo seriously check on lost mem blocks
 		m_pFormatContext = nullptr;
 	}
+
+	// after the seek index, its thread reads the mapping too
+	if(m_pMappedFile!=nullptr)
+		MappedFile::freeIOContext((AVIOContext*)m_pIOContext);
+	else if(m_pIOContext!=nullptr)
+	{
+		av_free(((AVIOContext*)m_pIOContext)->buffer);
+		av_free(m_pIOContext);
+	}
+	m_pIOContext = nullptr;
+	m_pInputSource = nullptr;
+	if(m_pMappedFile!=nullptr)
+	{
+		delete m_pMappedFile;
+		m_pMappedFile = nullptr;
+	}
+	m_bIsFileOpen = false;
 }
 
 void FFmpegWrapper::play()
+{
+	{
+		boost::mutex::scoped_lock scopedLock(m_OpenMutex);
+		if(m_bOpening)
+		{
+			m_bPlayAfterOpen = true;	// the open thread starts playing
+			return;
+		}
+	}
+	startPlayback();
+}
+
+bool FFmpegWrapper::preroll(long lFrameNumber, int iFrames)
+{
+	if(isOpening() || !m_bIsFileOpen || !hasVideo() || isImage())
+		return false;
+
+	// the ready queue holds the prerolled frames, so there can't be more than it takes
+	int iCapacity = m_pReadyFrames->getCapacity();
+	if(iFrames <= 0 || iFrames > iCapacity)
+		iFrames = iCapacity;
+
+	m_iState = ePaused;
+	m_dTargetTimeInMs = (m_dFps > EPS) ? lFrameNumber / m_dFps * 1000.0 : 0;
+	requestSeek(lFrameNumber, false);	// a cached frame would leave the pipeline behind, play would have to seek again
+	m_iPrerollFrames = iFrames;
+	publishDecodeSchedule();
+	startPlayerThreads();
+	if(m_pGroup != nullptr)
+		m_pGroup->wake();
+	return true;
+}
+
+bool FFmpegWrapper::prerollTime(double dTimeInMs, int iFrames)
+{
+	return preroll(calculateFrameNumberFromTime(dTimeInMs), iFrames);
+}
+
+bool FFmpegWrapper::isPrerolled()
+{
+	if(m_iPrerollFrames <= 0)
+		return false;
+	int iBuffered = m_pReadyFrames->size();
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	if(!m_bFrameRequested)
+		iBuffered++;		// the first one is presented already
+	return iBuffered >= m_iPrerollFrames || m_bEndOfStream;
+}
+
+void FFmpegWrapper::startPlayback()
 {
 	if(!isImage())
 	{
-		m_iState = ePlaying;
-	/*	if(!m_bIsThreadRunning)
+		if(m_iState == eEof)	// replay a finished not looping file from its start
+			requestSeek(m_iDirection == eForward ? 0 : m_lDurationInFrames - 1, false);
+		else if(m_bSeekDeferred)	// continue next to the frame shown from the frame cache
+			requestSeek(m_lCurrentFrameNumber + m_iDirection, false);
+		if(m_iState != ePlaying)
 		{
-			m_bIsThreadRunning = true;
-			m_PlayerThread = boost::thread(&FFmpegWrapper::threadedPlayer, this);
-		}*/
+			m_OldTime = boost::chrono::steady_clock::now();		// the time while not playing doesn't count
+			m_dFramesDue = 0;
+		}
+		m_iState = ePlaying;
+		m_iPrerollFrames = 0;
+		publishDecodeSchedule();
+		startPlayerThreads();
+		if(m_pGroup != nullptr)
+			m_pGroup->wake();
 	}
 }
 
 void FFmpegWrapper::pause()
 {
+	{
+		boost::mutex::scoped_lock scopedLock(m_OpenMutex);
+		if(m_bOpening)
+		{
+			m_bPlayAfterOpen = false;
+			return;
+		}
+	}
 	m_iState = ePaused;
+	publishDecodeSchedule();
 }
 
 void FFmpegWrapper::stop()
 {
-	//if(m_bIsThreadRunning)
-	//{
-	//	m_bIsThreadRunning = false;
-	//	m_PlayerThread.join();
-	//}
+	{
+		boost::mutex::scoped_lock scopedLock(m_OpenMutex);
+		if(m_bOpening)
+		{
+			m_bPlayAfterOpen = false;
+			return;
+		}
+	}
+	stopPlayerThreads();
+	m_iPrerollFrames = 0;
 	m_lCurrentFrameNumber = -1;	// set to invalid, as it is not decoded yet
 	m_dTargetTimeInMs = 0;
 	m_iState = eStopped;
 	if(m_bIsFileOpen)
+	{
 		seekFrame(0);	// so unseekable files get reset too
+		if( m_pVideoCodecContext != nullptr)
+			avcodec_flush_buffers(m_pVideoCodecContext);
+		if( m_pAudioCodecContext != nullptr)
+			avcodec_flush_buffers(m_pAudioCodecContext);
+		if(m_pAudioFifo != nullptr)
+			m_pAudioFifo->flush();
+		m_iResampleInFormat = -1;	// drops the samples the resampler still holds
+		m_bAudioClockValid = false;
+		m_lAudioClockFrame.store(-1, boost::memory_order_relaxed);
+		m_bVideoBehindAudio.store(false, boost::memory_order_relaxed);
+		m_bSeekRequested = false;
+		m_bSeekDeferred = false;
+		m_bEndOfStream = false;
+		m_bDemuxFinished = false;
+		m_bFrameRequested = true;
+	}
+	publishDecodeSchedule();
 }
 
-AVData& FFmpegWrapper::getAVData()
+void FFmpegWrapper::startPlayerThreads()
 {
-	update();
-	return m_AVData;
+	if(m_bIsThreadRunning || !m_bIsFileOpen || !hasVideo() || isImage())
+		return;
+
+	m_pScalerCache->reset();
+	m_pReadyFrames->reset();
+	m_pVideoPackets->setCapacity(m_iPacketQueueDepth);
+	m_pAudioPackets->setCapacity(m_iPacketQueueDepth);
+	m_pPacketPool->setCapacity(2 * m_iPacketQueueDepth + 4);	// both queues plus the packets the threads are working on
+	m_pVideoPackets->reset();
+	m_pAudioPackets->reset();
+	m_bIsThreadRunning = true;
+	m_DemuxThread = boost::thread(&FFmpegWrapper::threadedDemuxer, this);
+	m_VideoThread = boost::thread(&FFmpegWrapper::threadedVideoDecoder, this);
+	if(hasAudio())
+		m_AudioThread = boost::thread(&FFmpegWrapper::threadedAudioDecoder, this);
 }
 
-VideoData& FFmpegWrapper::getVideoData()
+void FFmpegWrapper::stopPlayerThreads()
 {
-	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	if(!m_bIsThreadRunning)
+		return;
 
-	//update();
-	return m_AVData.m_VideoData;
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		m_bIsThreadRunning = false;
+		m_PlayerCondition.notify_all();
+	}
+	if(m_pGroup != nullptr)
+		m_pGroup->wake();		// a decoder waiting for a slot gives up
+	m_pVideoPackets->abort();
+	m_pAudioPackets->abort();
+	m_pScalerCache->abort();
+	m_pReadyFrames->abort();
+	m_DemuxThread.join();
+	m_VideoThread.join();
+	if(m_AudioThread.joinable())
+		m_AudioThread.join();
+
+	flushPacketQueues();
+	flushReadyFrames();
 }
 
-AudioData& FFmpegWrapper::getAudioData()
+void FFmpegWrapper::flushPacketQueues()
 {
-	boost::mutex::scoped_lock scopedLock(m_Mutex);
-
-	update();
-	return m_AVData.m_AudioData;
+	QueuedPacket packet;
+	while(m_pVideoPackets->tryPop(packet))
+		freeQueuedPacket(packet);
+	while(m_pAudioPackets->tryPop(packet))
+		freeQueuedPacket(packet);
 }
 
-void FFmpegWrapper::updateTimer()
+void FFmpegWrapper::freeQueuedPacket(QueuedPacket& packet)
 {
-	// todo check for very big over and underflow
-	double deltaTime = getDeltaTime();
-	if(m_iState == ePlaying)
+	if(packet.m_pPacket != nullptr)
 	{
-		m_dTargetTimeInMs +=  deltaTime * m_fSpeedMultiplier * m_iDirection;
+		m_pPacketPool->release(packet.m_pPacket);
+		packet.m_pPacket = nullptr;
+	}
+}
+
+bool FFmpegWrapper::pushPacketCommand(int iCommand, int iSerial, long lTargetFrame, long lLastFrame)
+{
+	QueuedPacket packet;
+	packet.m_pPacket = nullptr;
+	packet.m_iCommand = iCommand;
+	packet.m_iSerial = iSerial;
+	packet.m_lTargetFrame = lTargetFrame;
+	packet.m_lLastFrame = lLastFrame;
+	if(!m_pVideoPackets->push(packet))
+		return false;
+	if(iCommand == ePacketFlush && hasAudio())
+		return m_pAudioPackets->push(packet);
+	return true;
+}
 
-		// check for over underflows and correct according to loop mode and set according state
-		if(m_dTargetTimeInMs > m_dDurationInMs || m_dTargetTimeInMs < 0)
+// reads the container and feeds the per stream packet queues, owns seeking and loop handling
+void FFmpegWrapper::threadedDemuxer()
+{
+	int iDemuxSerial = -1;
+	long lLastDemuxedFrame = -1;	// frame number of the last video packet read
+	long lBackwardTarget = -1;		// next frame to produce while playing backwards
+	long lCachedEnd = -1;			// last frame queued from the frame cache, reading continues behind it
+
+	while(true)
+	{
+		long lSeekTarget = -1;
+		int iSerial = 0;
+		int iDirection = eForward;
 		{
-			if(m_iLoopMode == eNoLoop)
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			// idle at the end of a not looping stream until somebody seeks or stops
+			while(m_bIsThreadRunning && m_bDemuxFinished && !m_bSeekRequested)
+				m_PlayerCondition.wait(scopedLock);
+			if(!m_bIsThreadRunning)
+				break;
+			if(m_bSeekRequested)
+			{
+				lSeekTarget = m_lSeekTargetFrame;
+				m_bSeekRequested = false;
+				m_bDemuxFinished = false;
+			}
+			else if(lCachedEnd >= 0 && m_iDirection == eForward)
 			{
-				pause();
+				lSeekTarget = lCachedEnd + 1;
 			}
-			else if(m_iLoopMode == eLoop)
+			lCachedEnd = -1;
+			iSerial = m_iSerial;
+			iDirection = m_iDirection;
+		}
+
+		if(lSeekTarget >= 0)
+		{
+			// a user seek invalidates everything queued, a loop seek keeps the tail of the stream
+			if(iSerial != iDemuxSerial)
+				flushPacketQueues();
+
+			// frames in the frame cache are queued from there, audio needs the packets though
+			long lCachedFrame = -1;
+			if(iDirection == eForward && m_pFrameCache != nullptr && !hasAudio())
+				lCachedFrame = m_pFrameCache->findRun(lSeekTarget, eForward, m_iBackwardCacheFrames);
+			if(lCachedFrame >= 0)
 			{
-				seekFrame(0);
-				if(m_dTargetTimeInMs < 0) // underflow
+				if(!pushPacketCommand(ePacketCached, iSerial, lSeekTarget, lCachedFrame))
+					break;
+				lLastDemuxedFrame = lCachedFrame;
+				iDemuxSerial = iSerial;
+				if(m_lDurationInFrames == 0 || lCachedFrame + 1 < (long)m_lDurationInFrames)
 				{
-					m_dTargetTimeInMs = m_dDurationInMs;	
+					lCachedEnd = lCachedFrame;
 				}
-				else // overflow
+				else
 				{
-					m_dTargetTimeInMs = 0;
+					lBackwardTarget = -1;
+					if(!handleEndOfStream(iSerial, lBackwardTarget))
+						break;
 				}
+				continue;
+			}
+
+			if(iDirection == eForward)
+			{
+				seekFrame(lSeekTarget);
+				if(!pushPacketCommand(ePacketFlush, iSerial, lSeekTarget, -1))
+					break;
+				lLastDemuxedFrame = lSeekTarget - 1;
+			}
+			else
+			{
+				lBackwardTarget = lSeekTarget;
+			}
+		}
+		iDemuxSerial = iSerial;
+
+		if(iDirection == eBackward)
+		{
+			// ffmpeg can't decode backwards, so decode a segment forward from the keyframe in front of the target,
+			// the video decoder hands it out in reverse order while it already decodes the segment in front of it
+			if(lBackwardTarget < 0)
+				lBackwardTarget = lLastDemuxedFrame - 1;
+			if(lBackwardTarget < 0)
+			{
+				if(!handleEndOfStream(iSerial, lBackwardTarget))
+					break;
+				continue;
+			}
+
+			long lCachedFrame = (m_pFrameCache != nullptr) ? m_pFrameCache->findRun(lBackwardTarget, eBackward, m_iBackwardCacheFrames) : -1;
+			if(lCachedFrame >= 0)
+			{
+				if(!pushPacketCommand(ePacketCached, iSerial, lBackwardTarget, lCachedFrame))
+					break;
+				lLastDemuxedFrame = lCachedFrame;
+				lBackwardTarget = lCachedFrame - 1;
+				continue;
 			}
-			else if(m_iLoopMode == eLoopBidi)
+
+			seekFrame(lBackwardTarget);
+			long lFirstFrame = -1;
+			bool bIsAborted = false;
+			AVPacket* pAVPacket = nullptr;
+			while((pAVPacket = fetchAVPacket()) != nullptr)
 			{
-				if(m_dTargetTimeInMs < 0) // underflow
+				if(pAVPacket->stream_index != m_iVideoStream)
+				{
+					m_pPacketPool->release(pAVPacket);
+					continue;
+				}
+				if(lFirstFrame < 0 && (pAVPacket->flags & AV_PKT_FLAG_KEY) == 0)
+				{
+					// decoding must start on a keyframe, a segment starting anywhere else comes out corrupt
+					m_pPacketPool->release(pAVPacket);
+					continue;
+				}
+				if(lFirstFrame < 0)
+				{
+					// the seek landed on the keyframe, long gops are split so a segment fits into the backward cache
+					lFirstFrame = calculateFrameNumberFromPacket(pAVPacket);
+					bool bKeyFrameOnly = isKeyFramesOnly() && lFirstFrame >= 0 && lFirstFrame <= lBackwardTarget;
+					if(!bKeyFrameOnly && lFirstFrame < lBackwardTarget - m_iBackwardCacheFrames + 1)
+						lFirstFrame = lBackwardTarget - m_iBackwardCacheFrames + 1;
+					if(lFirstFrame > lBackwardTarget)
+						lFirstFrame = lBackwardTarget;
+					if(lFirstFrame < 0)
+						lFirstFrame = 0;
+					if(!pushPacketCommand(ePacketFlush, iSerial, lFirstFrame, bKeyFrameOnly ? lFirstFrame : lBackwardTarget))
+					{
+						m_pPacketPool->release(pAVPacket);
+						bIsAborted = true;
+						break;
+					}
+					if(bKeyFrameOnly)	// at extreme speeds just the keyframes are shown, one per segment
+					{
+						bIsAborted = !pushPacket(pAVPacket, iSerial);
+						break;
+					}
+				}
+				// packets are in decode order, so none after this one can be presented up to the target
+				boost::int64_t lDecodeTimestamp = (pAVPacket->dts != s_lNoPts) ? pAVPacket->dts : pAVPacket->pts;
+				if(lDecodeTimestamp != s_lNoPts && calculateFrameNumberFromPts(lDecodeTimestamp) > lBackwardTarget)
 				{
-					m_dTargetTimeInMs = fabs(m_dTargetTimeInMs);
-					m_iDirection = eForward;
+					m_pPacketPool->release(pAVPacket);
+					break;
 				}
-				else // overflow
+				if(!pushPacket(pAVPacket, iSerial))
 				{
-					m_dTargetTimeInMs = m_dDurationInMs + (m_dDurationInMs - m_dTargetTimeInMs);
-					m_iDirection = eBackward;
+					bIsAborted = true;
+					break;
 				}
 			}
+			if(bIsAborted)
+				break;
+			if(lFirstFrame < 0)
+				lFirstFrame = lBackwardTarget;		// nothing to read behind the target, skip it
+			else if(!pushPacketCommand(ePacketDrain, iSerial, -1, -1))
+				break;
+			lLastDemuxedFrame = lFirstFrame;
+			lBackwardTarget = lFirstFrame - 1;
+			continue;
 		}
-	}
-}
-
-void FFmpegWrapper::update()
-{
-	isFrameDecoded = false;
-	static bool bIsSeekable = true;
-
-	if(isImage())	// no update needed for already decoded image
-		return;
-	
-	// update timer for correct video sync to fps
-	//updateTimer();
 
-	// make sure always to decode 0 frame first, even if the first delta time would suggest differently
-	if(m_dCurrentTimeInMs<0)
-		m_dTargetTimeInMs = 0;
-
-	long lTargetFrame = m_lCurrentFrameNumber;//calculateFrameNumberFromTime(m_dTargetTimeInMs);
-	//if(lTargetFrame != m_lCurrentFrameNumber)
-	{
-		// probe to jump to target frame directly
-			
-		if(bIsSeekable)
+		AVPacket* pAVPacket = fetchAVPacket();
+		if(pAVPacket == nullptr)
 		{
-			bIsSeekable = seekFrame(lTargetFrame);
-			isFrameDecoded = decodeFrame();
-			if(!isFrameDecoded)
-			{
-			/*	seekFrame(0);
-				bIsSeekable = false;*/
-			}
+			// end of file, let the video decoder output its delayed frames and continue according to the loop mode
+			if(!pushPacketCommand(ePacketDrain, iSerial, -1, -1))
+				break;
+			lBackwardTarget = -1;
+			if(!handleEndOfStream(iSerial, lBackwardTarget))
+				break;
+			continue;
 		}
-			
-		if(!bIsSeekable)	// just forward decoding, this is a huge performance issue when playing backwards
+
+		if(pAVPacket->stream_index == m_iVideoStream)
 		{
-			/*if(lTargetFrame<=0)
+			lLastDemuxedFrame = calculateFrameNumberFromPacket(pAVPacket);
+			if(!(pAVPacket->flags & AV_PKT_FLAG_KEY) && isKeyFramesOnly())
 			{
-				seekFrame(0);
-				m_lCurrentFrameNumber = m_dCurrentTimeInMs = 0;
-			}*/
-
-			if( m_iState == ePlaying)
+				m_pPacketPool->release(pAVPacket);		// wouldn't be decoded anyway
+			}
+			else if(!pushPacket(pAVPacket, iSerial))
 			{
-				isFrameDecoded = decodeFrame();
-				m_dTargetTimeInMs = (float)(lTargetFrame) * 1.0 / m_dFps * 1000.0;
-					
+				break;
 			}
 		}
-
-		m_lCurrentFrameNumber++;// = lTargetFrame;
-		m_dCurrentTimeInMs = m_dTargetTimeInMs;
+		else if(pAVPacket->stream_index == m_iAudioStream)
+		{
+			if(!pushPacket(pAVPacket, iSerial))
+				break;
+		}
+		else
+		{
+			m_pPacketPool->release(pAVPacket);
+		}
 	}
 }
 
-
-AVPacket* FFmpegWrapper::fetchAVPacket()
+bool FFmpegWrapper::pushPacket(AVPacket* pAVPacket, int iSerial)
+{
+	QueuedPacket packet;
+	packet.m_pPacket = pAVPacket;
+	packet.m_iCommand = ePacketData;
+	packet.m_iSerial = iSerial;
+	packet.m_lTargetFrame = -1;
+	packet.m_lLastFrame = -1;
+
+	BoundedQueue<QueuedPacket>* pQueue = (pAVPacket->stream_index == m_iVideoStream) ? m_pVideoPackets : m_pAudioPackets;
+	if(pQueue->push(packet))	// blocks while the decoder is behind
+		return true;
+	freeQueuedPacket(packet);
+	return false;
+}
+
+// called by the demuxer thread at either end of the stream, lBackwardTarget is set when playing backwards continues
+bool FFmpegWrapper::handleEndOfStream(int iSerial, long& lBackwardTarget)
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	if(m_bSeekRequested)	// a pending seek wins over the loop handling
+		return true;
+
+	if(m_iLoopMode == eLoop)
+	{
+		if(m_iDirection == eForward)
+		{
+			m_lSeekTargetFrame = 0;
+			m_bSeekRequested = true;
+		}
+		else
+		{
+			lBackwardTarget = m_lDurationInFrames - 1;
+		}
+	}
+	else if(m_iLoopMode == eLoopBidi)
+	{
+		if(m_iDirection == eForward)
+		{
+			m_iDirection = eBackward;	// continues one in front of the last demuxed frame
+		}
+		else
+		{
+			m_iDirection = eForward;
+			m_lSeekTargetFrame = 1;
+			m_bSeekRequested = true;
+		}
+	}
+	else
+	{
+		m_bDemuxFinished = true;
+		scopedLock.unlock();
+		return pushPacketCommand(ePacketFinished, iSerial, -1, -1);
+	}
+	return true;
+}
+
+void FFmpegWrapper::threadedVideoDecoder()
+{
+	long lMinFrameNumber = 0;
+	long lMaxFrameNumber = -1;			// last frame of the backward segment, -1 when playing forward
+	long lLastFrameNumber = -1;
+	int iFlushSerial = -1;
+	bool bSegmentDone = false;
+	std::vector<VideoFrame*> segment;	// backward segment being decoded, in presentation order
+	std::vector<VideoFrame*> pending;	// previous backward segment, handed out from its end while the next one is decoded
+	QueuedPacket packet;
+
+	while(true)
+	{
+		if(pending.empty())
+		{
+			if(!m_pVideoPackets->pop(packet))
+				break;
+		}
+		else
+		{
+			// hand out what fits into the ready queue, wait for a free slot just if there's nothing to decode
+			if(!pushBackwardFrames(pending, false))
+				break;
+			if(!m_pVideoPackets->tryPop(packet))
+			{
+				if(!pushBackwardFrames(pending, true))
+					break;
+				continue;
+			}
+		}
+
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			if(packet.m_iSerial != m_iSerial)	// queued before the last seek
+			{
+				scopedLock.unlock();
+				freeQueuedPacket(packet);
+				continue;
+			}
+		}
+
+		bool bIsAborted = false;
+		if(packet.m_iCommand == ePacketFlush)
+		{
+			// a seek drops the frames of the old position, a loop or direction change plays them out first
+			releaseFrames(segment);
+			if(packet.m_iSerial != iFlushSerial)
+				releaseFrames(pending);
+			else if(packet.m_lLastFrame < 0)
+				bIsAborted = !pushBackwardFrames(pending, true, true);
+			iFlushSerial = packet.m_iSerial;
+
+			avcodec_flush_buffers(m_pVideoCodecContext);
+			lMinFrameNumber = packet.m_lTargetFrame;
+			lMaxFrameNumber = packet.m_lLastFrame;
+			m_lLastOutputFrame = -1;
+			bSegmentDone = false;
+		}
+		else if(packet.m_iCommand == ePacketData)
+		{
+			// fast playback doesn't decode what it can't show anyway, b-frames are never referenced by other frames,
+			// switching to and from keyframes only comes with a seek, see setSpeed()
+			if(isKeyFramesOnly())
+				m_pVideoCodecContext->skip_frame = AVDISCARD_NONKEY;
+			else if(getFrameSkip() > 1 && lMaxFrameNumber < 0)
+				m_pVideoCodecContext->skip_frame = AVDISCARD_NONREF;
+			else if(m_bVideoBehindAudio.load(boost::memory_order_relaxed) && lMaxFrameNumber < 0)
+				m_pVideoCodecContext->skip_frame = AVDISCARD_NONREF;
+			else
+				m_pVideoCodecContext->skip_frame = AVDISCARD_DEFAULT;
+
+			if(!bSegmentDone && decodeVideoFrame(packet.m_pPacket, true))
+				bIsAborted = !outputVideoFrame(packet.m_iSerial, lMinFrameNumber, lMaxFrameNumber, lLastFrameNumber, bSegmentDone, segment);
+			freeQueuedPacket(packet);
+		}
+		else if(packet.m_iCommand == ePacketDrain)
+		{
+			// feed empty packets to get the frames still delayed in the decoder
+			AVPacket emptyPacket;
+			av_init_packet(&emptyPacket);
+			emptyPacket.data = nullptr;
+			emptyPacket.size = 0;
+			while(!bIsAborted && !bSegmentDone && decodeVideoFrame(&emptyPacket, true))
+				bIsAborted = !outputVideoFrame(packet.m_iSerial, lMinFrameNumber, lMaxFrameNumber, lLastFrameNumber, bSegmentDone, segment);
+
+			// the backward segment is complete, it's handed out as soon as the previous one is
+			if(!bIsAborted && lMaxFrameNumber >= 0)
+			{
+				bIsAborted = !pushBackwardFrames(pending, true, true);
+				pending.swap(segment);
+			}
+		}
+		else if(packet.m_iCommand == ePacketCached)
+		{
+			// frames from the frame cache, queued after the previous segment like a decoded one
+			releaseFrames(segment);
+			if(packet.m_iSerial != iFlushSerial)
+				releaseFrames(pending);
+			iFlushSerial = packet.m_iSerial;
+			bIsAborted = !pushBackwardFrames(pending, true, true);
+			m_pFrameCache->collect(packet.m_lTargetFrame, packet.m_lLastFrame, pending);
+			std::reverse(pending.begin(), pending.end());
+			for(size_t i=0; i<pending.size(); i++)
+				pending[i]->m_iSerial = packet.m_iSerial;
+			bSegmentDone = true;
+		}
+		else if(packet.m_iCommand == ePacketFinished)
+		{
+			bIsAborted = !pushBackwardFrames(pending, true, true);
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			m_bEndOfStream = true;
+		}
+
+		if(bIsAborted)
+			break;
+	}
+	releaseFrames(segment);
+	releaseFrames(pending);
+}
+
+// converts the picture just decoded into a free frame buffer and queues it, or adds it to the backward segment if
+// lMaxFrameNumber is set, returns false if the player is shutting down
+bool FFmpegWrapper::outputVideoFrame(int iSerial, long lMinFrameNumber, long lMaxFrameNumber, long& lLastFrameNumber, bool& bSegmentDone, std::vector<VideoFrame*>& segment)
+{
+	int64_t lTimestamp = m_pVideoFrame->best_effort_timestamp;
+	if(lTimestamp == s_lNoPts)
+		lTimestamp = m_pVideoFrame->pkt_dts;
+	long lFrameNumber = (lTimestamp == s_lNoPts) ? lLastFrameNumber + 1 : calculateFrameNumberFromPts(lTimestamp);
+	lLastFrameNumber = lFrameNumber;
+
+	// frames in front of a seek target or behind a backward segment are decoded but never converted
+	if(lFrameNumber < lMinFrameNumber)
+		return true;
+	if(lMaxFrameNumber >= 0 && lFrameNumber > lMaxFrameNumber)
+	{
+		bSegmentDone = true;
+		return true;
+	}
+
+	// neither are frames the presentation would skip at the current speed
+	int iSkip = getFrameSkip();
+	if(iSkip > 1)
+	{
+		if(lMaxFrameNumber >= 0 && (lMaxFrameNumber - lFrameNumber) % iSkip != 0)
+			return true;
+		if(lMaxFrameNumber < 0 && m_lLastOutputFrame >= 0 && lFrameNumber > m_lLastOutputFrame && lFrameNumber - m_lLastOutputFrame < iSkip)
+			return true;
+	}
+
+	// nor are frames the audio clock passed already, within a few seconds so a loop doesn't count as late
+	long lAudioClockFrame = m_lAudioClockFrame.load(boost::memory_order_relaxed);
+	if(lMaxFrameNumber < 0 && lAudioClockFrame >= 0 && lFrameNumber < lAudioClockFrame && lAudioClockFrame - lFrameNumber < (long)(m_dFps * 2.0))
+	{
+		m_pCounters->m_lFramesDropped.fetch_add(1, boost::memory_order_relaxed);
+		return true;
+	}
+	m_lLastOutputFrame = lFrameNumber;
+
+	VideoFrame* pFrame = convertVideoFrame(true);		// blocks while all frames are queued or held by the application
+	if(pFrame == nullptr)
+		return false;
+
+	pFrame->m_lFrameNumber = lFrameNumber;
+	pFrame->m_lPts = (m_pVideoFrame->pkt_pts == s_lNoPts) ? 0 : m_pVideoFrame->pkt_pts;
+	pFrame->m_lDts = (m_pVideoFrame->pkt_dts == s_lNoPts) ? 0 : m_pVideoFrame->pkt_dts;
+	pFrame->m_iSerial = iSerial;
+	if(m_pFrameCache != nullptr)
+		m_pFrameCache->insert(pFrame);
+	if(lMaxFrameNumber >= 0)
+	{
+		segment.push_back(pFrame);
+		bSegmentDone = (lFrameNumber >= lMaxFrameNumber);
+		return true;
+	}
+
+	if(!m_pReadyFrames->push(pFrame))
+	{
+		FramePool::release(pFrame);
+		return false;
+	}
+	return true;
+}
+
+// queues the frames of a backward segment from its end, either as many as fit, or waiting for one or for all of them
+// to fit, frames of an older serial are dropped, returns false if the player is shutting down
+bool FFmpegWrapper::pushBackwardFrames(std::vector<VideoFrame*>& frames, bool bWait, bool bAll)
+{
+	if(frames.empty())
+		return true;
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		if(frames.back()->m_iSerial != m_iSerial)
+		{
+			scopedLock.unlock();
+			releaseFrames(frames);
+			return true;
+		}
+	}
+
+	while(!frames.empty())
+	{
+		if(bWait)
+		{
+			if(!m_pReadyFrames->push(frames.back()))
+				return false;		// released by the caller
+			bWait = bAll;
+		}
+		else if(!m_pReadyFrames->tryPush(frames.back()))
+		{
+			break;
+		}
+		frames.pop_back();
+	}
+	return true;
+}
+
+void FFmpegWrapper::threadedAudioDecoder()
 {
-	AVPacket *pAVPacket = nullptr;
+	QueuedPacket packet;
+
+	while(m_pAudioPackets->pop(packet))
+	{
+		bool bIsCurrent = true;
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			bIsCurrent = (packet.m_iSerial == m_iSerial);
+		}
+
+		if(bIsCurrent && packet.m_iCommand == ePacketFlush)
+		{
+			avcodec_flush_buffers(m_pAudioCodecContext);
+			m_pAudioFifo->flush();
+			m_iResampleInFormat = -1;
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			m_bAudioClockValid = false;
+		}
+		else if(bIsCurrent && packet.m_iCommand == ePacketData)
+			decodeAudioFrame(packet.m_pPacket, packet.m_iSerial);
+		freeQueuedPacket(packet);
+	}
+}
+
+void FFmpegWrapper::requestSeek(long lTargetFrameNumber, bool bUseCache)
+{
+	if(lTargetFrameNumber < 0)
+		lTargetFrameNumber = 0;
+	if(m_lDurationInFrames > 0 && lTargetFrameNumber >= (long)m_lDurationInFrames)
+		lTargetFrameNumber = m_lDurationInFrames - 1;
+
+	// while not playing a cached frame is shown right away, the pipeline just follows when playback continues
+	if(bUseCache && m_pFrameCache != nullptr && m_iState != ePlaying)
+	{
+		VideoFrame* pFrame = m_pFrameCache->lookup(lTargetFrameNumber);
+		if(pFrame != nullptr)
+		{
+			{
+				boost::mutex::scoped_lock scopedLock(m_Mutex);
+				m_bFrameRequested = false;
+				m_bSeekDeferred = true;
+			}
+			presentFrame(pFrame);
+			return;
+		}
+	}
+
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		m_lSeekTargetFrame = lTargetFrameNumber;
+		m_bSeekRequested = true;
+		m_bSeekDeferred = false;
+		m_bFrameRequested = true;
+		m_bEndOfStream = false;
+		m_lAudioClockFrame.store(-1, boost::memory_order_relaxed);
+		m_iSerial++;
+		m_PlayerCondition.notify_all();
+	}
+	publishDecodeSchedule();
+	// hand the outdated frames back, this also wakes up a video decoder waiting for a free buffer
+	flushReadyFrames();
+	if(m_pGroup != nullptr)
+		m_pGroup->wake();
+}
+
+void FFmpegWrapper::flushReadyFrames()
+{
+	VideoFrame* pFrame = nullptr;
+	while(m_pReadyFrames->tryPop(pFrame))
+		FramePool::release(pFrame);
+}
+
+bool FFmpegWrapper::presentNextFrame()
+{
+	VideoFrame* pFrame = nullptr;
+	while(m_pReadyFrames->tryPop(pFrame))
+	{
+		if(pFrame->m_iSerial == m_iSerial)
+			break;
+		FramePool::release(pFrame);		// decoded before the last seek
+		pFrame = nullptr;
+	}
+	if(pFrame == nullptr)
+		return false;
+
+	presentFrame(pFrame);
+	return true;
+}
+
+// shows the frame and takes over the caller's reference
+void FFmpegWrapper::presentFrame(VideoFrame* pFrame)
+{
+	m_pCounters->m_lFramesPresented.fetch_add(1, boost::memory_order_relaxed);
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_bNewFrame = true;
+	m_lLastScheduledFrame = pFrame->m_lFrameNumber;
+	m_AVData.m_VideoData.m_Frame = FrameHandle(pFrame);		// the previous frame goes back to the pool unless the application still holds it
+	FramePool::release(pFrame);								// reference of the ready queue or cache lookup
+	m_AVData.m_VideoData.m_iWidth = pFrame->m_iWidth;
+	m_AVData.m_VideoData.m_iHeight = pFrame->m_iHeight;
+	m_AVData.m_VideoData.m_iPixelFormat = pFrame->m_iPixelFormat;
+	m_AVData.m_VideoData.m_iChannels = getChannelCount(pFrame->m_iPixelFormat);
+	m_AVData.m_VideoData.m_pData = pFrame->m_pPlanes[0];
+	for(int i=0; i<4; i++)
+	{
+		m_AVData.m_VideoData.m_pPlanes[i] = pFrame->m_pPlanes[i];
+		m_AVData.m_VideoData.m_iLinesizes[i] = pFrame->m_iLinesizes[i];
+	}
+	m_AVData.m_VideoData.m_lPts = pFrame->m_lPts;
+	m_AVData.m_VideoData.m_lDts = pFrame->m_lDts;
+	m_lCurrentFrameNumber = pFrame->m_lFrameNumber;
+	if(m_dFps > EPS)
+		m_dCurrentTimeInMs = m_lCurrentFrameNumber / m_dFps * 1000.0;
+}
+
+AVData& FFmpegWrapper::getAVData()
+{
+	update();
+	return m_AVData;
+}
+
+VideoData& FFmpegWrapper::getVideoData()
+{
+	update();
+
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return m_AVData.m_VideoData;
+}
+
+AudioData& FFmpegWrapper::getAudioData()
+{
+	if(!hasVideo())		// otherwise audio is decoded by the audio decoder thread
+		update();
+
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return m_AVData.m_AudioData;
+}
+
+void FFmpegWrapper::update()
+{
+	if(isOpening() || isImage())	// no update needed for already decoded image
+		return;
+
+	double dElapsedMs = getDeltaTime();		// always taken, so the time while paused doesn't count
+	if(!hasVideo())
+	{
+		// audio only files are still decoded on the calling thread, enough to keep the audio fifo half full
+		if(m_iState == ePlaying)
+		{
+			for(int i=0; i<16 && m_pAudioFifo != nullptr && m_pAudioFifo->getBufferedFrames() < m_pAudioFifo->getCapacity() / 2; i++)
+			{
+				if(!decodeFrame())
+					break;
+			}
+		}
+		return;
+	}
+
+	if(!m_bSeekIndexApplied)
+		applySeekIndexInfo();
+
+	if(m_bFrameRequested)
+	{
+		// after open and seeks the first frame is shown as soon as it is there, the clock starts from it
+		if(presentNextFrame())
+		{
+			m_bFrameRequested = false;
+			m_dFramesDue = 0;
+		}
+	}
+	else if(m_iState == ePlaying)
+	{
+		bool bPresented = false;
+		if(!m_bRealtime)
+		{
+			// no clock, the decoder sets the pace and nothing is late
+			m_bAudioSyncActive = false;
+			m_lAudioClockFrame.store(-1, boost::memory_order_relaxed);
+			bPresented = presentNextFrame();
+		}
+		else
+		{
+			// the audio clock replaces the wall clock as long as somebody pulls the audio
+			double dFramesElapsed = dElapsedMs * m_dFps * m_fSpeedMultiplier / 1000.0;
+			double dAudioFrames = 0;
+			m_bAudioSyncActive = m_lLastScheduledFrame >= 0 && getAudioClock(dAudioFrames);
+			if(m_bAudioSyncActive)
+				dFramesElapsed = dAudioFrames - m_lLastScheduledFrame - m_dFramesDue;
+			else
+				m_lAudioClockFrame.store(-1, boost::memory_order_relaxed);
+
+			bPresented = presentScheduledFrame(dFramesElapsed);
+			if(m_bAudioSyncActive)
+				updateAudioVideoDrift(dAudioFrames);
+		}
+		if(!bPresented && m_pReadyFrames->isEmpty())
+		{
+			boost::mutex::scoped_lock scopedLock(m_Mutex);
+			if(m_bEndOfStream)
+				m_iState = eEof;
+		}
+	}
+	publishDecodeSchedule();
+}
+
+// shows the frame due at the presentation clock, frames which are late already are dropped, returns false if
+// there is no new frame due yet
+bool FFmpegWrapper::presentScheduledFrame(double dFramesElapsed)
+{
+	m_dFramesDue += dFramesElapsed;
+
+	VideoFrame* pFrame = nullptr;
+	VideoFrame* pNextFrame = nullptr;
+	while(m_pReadyFrames->tryPeek(pNextFrame))
+	{
+		if(pNextFrame->m_iSerial != m_iSerial)
+		{
+			if(m_pReadyFrames->tryPop(pNextFrame))
+				FramePool::release(pNextFrame);		// decoded before the last seek
+			continue;
+		}
 
-	pAVPacket = new AVPacket();
-	if(av_read_frame(m_pFormatContext, pAVPacket)>=0)
+		// distance to the shown frame in either direction, frames skipped by the decoder count too,
+		// wrapping at a loop or a bidi turn counts as one
+		long lDistance = labs(pNextFrame->m_lFrameNumber - m_lLastScheduledFrame);
+		if(lDistance == 0 || m_lLastScheduledFrame < 0 || lDistance > 2 * getFrameSkip() + 2)
+			lDistance = 1;
+		if(lDistance > m_dFramesDue)
+			break;
+
+		if(!m_pReadyFrames->tryPop(pNextFrame))
+			break;
+		m_dFramesDue -= lDistance;
+		if(pFrame != nullptr)
+		{
+			FramePool::release(pFrame);		// late, the next one is due already
+			m_pCounters->m_lFramesDropped.fetch_add(1, boost::memory_order_relaxed);
+		}
+		pFrame = pNextFrame;
+		m_lLastScheduledFrame = pFrame->m_lFrameNumber;
+	}
+
+	// don't build up a backlog while the decoder can't keep up, better drop frames than play them out in a hurry
+	double dMaxDue = 2.0 * getFrameSkip() + 1.0;
+	if(m_dFramesDue > dMaxDue)
+		m_dFramesDue = dMaxDue;
+
+	if(pFrame == nullptr)
+		return false;
+	presentFrame(pFrame);
+	return true;
+}
+
+AVPacket* FFmpegWrapper::fetchAVPacket()
+{
+	AVPacket* pAVPacket = m_pPacketPool->acquire();
+	boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+	int iResult = av_read_frame(m_pFormatContext, pAVPacket);
+	m_pCounters->m_Demux.add(start);
+	if(iResult>=0 && m_pPacketPool->own(pAVPacket))
+	{
+		m_pCounters->m_lPacketsDemuxed.fetch_add(1, boost::memory_order_relaxed);
+		m_pCounters->m_lBytesDemuxed.fetch_add(pAVPacket->size, boost::memory_order_relaxed);
 		return pAVPacket;
-	else 
+	}
+
+	m_pPacketPool->release(pAVPacket);
+	return nullptr;
+}
+
+bool FFmpegWrapper::decodeFrame()
+{
+	bool bRet = false;
+	
+	for(unsigned int i=0; i<m_pFormatContext->nb_streams; i++)
+	{
+		AVPacket* pAVPacket = fetchAVPacket();
+		
+		if(pAVPacket!=nullptr)
+		{
+			// Is this a packet from the video stream?
+			if(pAVPacket->stream_index == m_iVideoStream) 
+			{
+				bRet = false;
+				bRet = decodeVideoFrame(pAVPacket);
+			}
+			else if(pAVPacket->stream_index == m_iAudioStream)
+			{
+				bRet = false;
+				bRet = decodeAudioFrame(pAVPacket);
+			}
+    
+			m_pPacketPool->release(pAVPacket);
+
+			if(!bRet)
+				return false;
+		}
+	}
+	return bRet;
+}
+
+// converts the picture just decoded into a frame of the current output format, the frame is returned with one reference
+VideoFrame* FFmpegWrapper::convertVideoFrame(bool bBlocking)
+{
+	int iWidth, iHeight, iPixelFormat, iFlags, iRowAlignment;
+	getOutputSpec(iWidth, iHeight, iPixelFormat, iFlags, iRowAlignment);
+
+	// the source is taken from the codec, as some streams change their size midway
+	SwsContext* pContext = nullptr;
+	PixelConverter::Function pConvert = nullptr;
+	FramePool* pPool = nullptr;
+	if(!m_pScalerCache->select(m_pVideoCodecContext->width, m_pVideoCodecContext->height, m_pVideoCodecContext->pix_fmt, iWidth, iHeight, iPixelFormat, iFlags, iRowAlignment, pContext, pConvert, pPool))
 		return nullptr;
+
+	VideoFrame* pFrame = bBlocking ? pPool->acquire() : pPool->tryAcquire();
+	if(pFrame == nullptr)
+		return nullptr;
+
+	// the video decoder thread converts in a slot of its group, but doesn't hold one while waiting for a free frame
+	if(bBlocking && !acquireGroupSlot())
+	{
+		FramePool::release(pFrame);
+		return nullptr;
+	}
+
+	if(pConvert != nullptr)
+	{
+		boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+		pConvert(m_pVideoFrame->data, m_pVideoFrame->linesize, pFrame->m_pPlanes[0], pFrame->m_iLinesizes[0], iWidth, iHeight);
+		m_pCounters->m_Scale.add(start);
+	}
+	else if(pContext == nullptr)
+	{
+		// output equals the source, the decoder reuses its buffers so the planes are copied into the pooled frame, but not converted
+		AVPicture picture;
+		memset(&picture, 0, sizeof(picture));
+		for(int i=0; i<4; i++)
+		{
+			picture.data[i] = pFrame->m_pPlanes[i];
+			picture.linesize[i] = pFrame->m_iLinesizes[i];
+		}
+		boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+		av_picture_copy(&picture, (AVPicture*)m_pVideoFrame, m_pVideoCodecContext->pix_fmt, iWidth, iHeight);
+		m_pCounters->m_Copy.add(start);
+	}
+	else
+	{
+		boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+		sws_scale(pContext, m_pVideoFrame->data, m_pVideoFrame->linesize, 0, m_pVideoCodecContext->height, pFrame->m_pPlanes, pFrame->m_iLinesizes);
+		m_pCounters->m_Scale.add(start);
+	}
+
+	if(bBlocking)
+		releaseGroupSlot();
+	return pFrame;
+}
+
+bool FFmpegWrapper::decodeVideoFrame(AVPacket* pAVPacket, bool bInSlot)
+{
+	int isFrameDecoded=0;
+
+	if(bInSlot && !acquireGroupSlot())
+		return false;
+
+	// Decode video frame
+	boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+	int iResult = avcodec_decode_video2(m_pVideoCodecContext, m_pVideoFrame, &isFrameDecoded, pAVPacket);
+	m_pCounters->m_VideoDecode.add(start);
+	if(bInSlot)
+		releaseGroupSlot();
+	if(iResult<0)
+		return false;
+			
+	// Did we get a video frame?
+	if(isFrameDecoded == 0)
+		return false;
+	m_pCounters->m_lFramesDecoded.fetch_add(1, boost::memory_order_relaxed);
+	return true;
+}
+
+bool FFmpegWrapper::acquireGroupSlot()
+{
+	return (m_pGroup == nullptr) || m_pGroup->acquireSlot(this);
+}
+
+void FFmpegWrapper::releaseGroupSlot()
+{
+	if(m_pGroup != nullptr)
+		m_pGroup->releaseSlot();
+}
+
+// called by the group, a player which won't present anything soon doesn't need to decode, a preroll was asked for explicitly
+bool FFmpegWrapper::isDecodeActive()
+{
+	int iReadyFrames = m_pReadyFrames->size();
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	if(m_DecodeSchedule.m_iPrerollFrames > 0 && iReadyFrames < m_DecodeSchedule.m_iPrerollFrames)
+		return true;
+	return m_DecodeSchedule.m_bActive;
+}
+
+// seconds until the presentation runs out of decoded frames, a requested frame is due right away
+double FFmpegWrapper::getDecodeDeadline()
+{
+	int iReadyFrames = m_pReadyFrames->size();
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	if(m_DecodeSchedule.m_bFrameRequested)
+		return -1.0;
+	if(m_DecodeSchedule.m_dFramesPerSecond < EPS)
+		return 0;
+	return (iReadyFrames * m_DecodeSchedule.m_iFrameSkip - m_DecodeSchedule.m_dFramesDue) / m_DecodeSchedule.m_dFramesPerSecond;
+}
+
+// called by the main thread whenever the state the deadlines depend on changes, at least once per update
+void FFmpegWrapper::publishDecodeSchedule()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_DecodeSchedule.m_bActive = m_bVisible && (m_iState == ePlaying || m_bFrameRequested);
+	m_DecodeSchedule.m_bFrameRequested = m_bFrameRequested;
+	m_DecodeSchedule.m_iPrerollFrames = (m_iState != ePlaying) ? m_iPrerollFrames : 0;
+	m_DecodeSchedule.m_iFrameSkip = getFrameSkip();
+	m_DecodeSchedule.m_dFramesDue = m_dFramesDue;
+	m_DecodeSchedule.m_dFramesPerSecond = m_dFps * m_fSpeedMultiplier;
+}
+
+// a packet may hold several audio frames (mp3 or ac3 in avi, mpeg-ps), the decoder is called until it is used up
+bool FFmpegWrapper::decodeAudioFrame(AVPacket* pAVPacket, int iSerial)
+{
+	AVPacket packet = *pAVPacket;		// a copy, data and size are advanced by what the decoder consumed
+	bool bFirstFrame = true;
+	do
+	{
+		int isFrameDecoded=0;
+		boost::chrono::steady_clock::time_point start = boost::chrono::steady_clock::now();
+		int iResult = avcodec_decode_audio4(m_pAudioCodecContext, m_pAudioFrame, &isFrameDecoded, &packet);
+		m_pCounters->m_AudioDecode.add(start);
+
+		boost::mutex::scoped_lock scopedLock(m_Mutex);	// audio data is written by the audio decoder thread
+		if(iResult<0)
+		{
+			m_AVData.m_AudioData.m_pData = nullptr;
+			return !bFirstFrame;		// the frames in front of the broken one are out already
+		}
+		if(isFrameDecoded)
+		{
+			m_AVData.m_AudioData.m_pData = m_pAudioFrame->data[0];
+			m_AVData.m_AudioData.m_lSizeInBytes = av_samples_get_buffer_size(NULL, m_pAudioCodecContext->channels, m_pAudioFrame->nb_samples, m_pAudioCodecContext->sample_fmt, 1);	// 1 stands for don't align size
+			m_AVData.m_AudioData.m_lPts = m_pAudioFrame->pkt_pts;
+			m_AVData.m_AudioData.m_lDts = m_pAudioFrame->pkt_dts;
+			if(m_AVData.m_AudioData.m_lPts == s_lNoPts)
+				m_AVData.m_AudioData.m_lPts = 0;
+			if(m_AVData.m_AudioData.m_lDts == s_lNoPts)
+				m_AVData.m_AudioData.m_lDts = 0;
+		}
+		scopedLock.unlock();
+
+		if(isFrameDecoded)
+		{
+			// the later frames of the packet carry its timestamp too, so just the first one anchors the clock
+			if(bFirstFrame)
+				anchorAudioClock(iSerial);
+			writeAudioFifo(iSerial);
+			bFirstFrame = false;
+		}
+		if(iResult == 0 && !isFrameDecoded)
+			break;		// nothing consumed and nothing out, the rest isn't decodable
+		packet.data = (packet.data != nullptr) ? packet.data + iResult : nullptr;
+		packet.size -= iResult;
+	}
+	while(packet.size > 0);
+	return true;
+}
+
+// hands the decoded samples to the audio fifo, the audio decoder thread (iSerial >= 0) waits for room as long as
+// somebody reads from the fifo, otherwise samples which don't fit are dropped and counted as overrun
+void FFmpegWrapper::writeAudioFifo(int iSerial)
+{
+	if(m_pAudioFifo == nullptr)
+		return;
+
+	const unsigned char* const* pPlanes = m_pAudioFrame->extended_data;
+	int iFrames = m_pAudioFrame->nb_samples;
+	int iChannels = m_pAudioCodecContext->channels;
+	bool bPlanar = av_sample_fmt_is_planar(m_pAudioCodecContext->sample_fmt) && iChannels > 1;
+	unsigned char* pResampled = nullptr;
+	if(m_bResampleAudio)
+	{
+		iFrames = resampleAudioFrame();
+		if(iFrames <= 0)
+			return;
+		pResampled = &m_ResampleBuffer[0];
+		pPlanes = &pResampled;
+		bPlanar = false;
+	}
+
+	int iWritten = 0;
+	int iIdlePolls = 0;
+	unsigned int iReadCount = m_pAudioFifo->getReadCount();
+	while(true)
+	{
+		if(bPlanar)
+			iWritten += m_pAudioFifo->writePlanar(pPlanes, iChannels, iWritten, iFrames - iWritten);
+		else
+			iWritten += m_pAudioFifo->write(pPlanes[0] + iWritten * m_pAudioFifo->getFrameSize(), iFrames - iWritten);
+		if(iWritten >= iFrames || iSerial < 0)
+			break;
+
+		boost::this_thread::sleep_for(boost::chrono::milliseconds(5));
+		if(m_pAudioFifo->getReadCount() != iReadCount)
+		{
+			iReadCount = m_pAudioFifo->getReadCount();
+			iIdlePolls = 0;
+		}
+		else if(++iIdlePolls >= 40)
+			break;		// nobody reads for 200 ms, don't stall the demuxer for it
+
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		if(!m_bIsThreadRunning || iSerial != m_iSerial)
+			return;
+	}
+	m_pAudioFifo->drop(iFrames - iWritten);
+}
+
+// converts the decoded audio frame to the output spec into the resample buffer, the resampler is set up again whenever
+// the decoder output changes, returns the number of converted sample frames
+int FFmpegWrapper::resampleAudioFrame()
+{
+	boost::uint64_t lInLayout = m_pAudioCodecContext->channel_layout;
+	if(lInLayout == 0 || av_get_channel_layout_nb_channels(lInLayout) != m_pAudioCodecContext->channels)
+		lInLayout = av_get_default_channel_layout(m_pAudioCodecContext->channels);
+
+	if(m_pResampler == nullptr || m_iResampleInFormat != m_pAudioCodecContext->sample_fmt || m_iResampleInSampleRate != m_pAudioCodecContext->sample_rate || m_lResampleInLayout != lInLayout)
+	{
+		m_pResampler = swr_alloc_set_opts(m_pResampler, av_get_default_channel_layout(m_iAudioFifoChannels), (AVSampleFormat)m_iAudioFifoFormat, m_iAudioFifoSampleRate,
+			lInLayout, m_pAudioCodecContext->sample_fmt, m_pAudioCodecContext->sample_rate, 0, nullptr);
+		if(m_pResampler == nullptr || swr_init(m_pResampler) < 0)
+		{
+			m_iResampleInFormat = -1;
+			return 0;
+		}
+		m_iResampleInFormat = m_pAudioCodecContext->sample_fmt;
+		m_iResampleInSampleRate = m_pAudioCodecContext->sample_rate;
+		m_lResampleInLayout = lInLayout;
+	}
+
+	// room for the rate change plus what the resampler buffered from earlier frames
+	int iMaxFrames = (int)((boost::int64_t)m_pAudioFrame->nb_samples * m_iAudioFifoSampleRate / m_pAudioCodecContext->sample_rate) + 256;
+	size_t iBytes = (size_t)iMaxFrames * m_pAudioFifo->getFrameSize();
+	if(m_ResampleBuffer.size() < iBytes)
+		m_ResampleBuffer.resize(iBytes);
+
+	uint8_t* pOut = &m_ResampleBuffer[0];
+	return swr_convert(m_pResampler, &pOut, iMaxFrames, (const uint8_t**)m_pAudioFrame->extended_data, m_pAudioFrame->nb_samples);
+}
+
+// ties the position in the audio fifo the decoded frame is written to with its timestamp, samples are counted from
+// there on, so the anchor just moves with seeks, loops and gaps in the stream
+void FFmpegWrapper::anchorAudioClock(int iSerial)
+{
+	if(m_pAudioFifo == nullptr)
+		return;
+	int64_t lTimestamp = m_pAudioFrame->best_effort_timestamp;
+	if(lTimestamp == s_lNoPts)
+		lTimestamp = m_pAudioFrame->pkt_pts;
+	if(lTimestamp == s_lNoPts)
+		return;
+
+	double dTime = calculateAudioTime(lTimestamp);
+	unsigned int iPosition = m_pAudioFifo->getWritePosition();
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	double dExpected = m_dAudioClockTime + (double)(int)(iPosition - m_iAudioClockPosition) / m_iAudioFifoSampleRate;
+	if(!m_bAudioClockValid || iSerial != m_iAudioClockSerial || fabs(dExpected - dTime) > 0.1)
+	{
+		m_iAudioClockPosition = iPosition;
+		m_dAudioClockTime = dTime;
+		m_iAudioClockSerial = iSerial;
+		m_bAudioClockValid = true;
+	}
+}
+
+// the position of the sound card in frames, false if there is no audio to sync to right now
+bool FFmpegWrapper::getAudioClock(double& dFrames)
+{
+	if(!m_bAudioSync || m_pAudioFifo == nullptr || m_iDirection != eForward || fabs(m_fSpeedMultiplier - 1.0f) > EPS)
+		return false;
+
+	// nobody reads the audio for a while, so it can't be the clock
+	boost::chrono::steady_clock::time_point now = boost::chrono::steady_clock::now();
+	unsigned int iReadCount = m_pAudioFifo->getReadCount();
+	if(iReadCount != m_iLastAudioReadCount)
+	{
+		m_iLastAudioReadCount = iReadCount;
+		m_LastAudioReadTime = now;
+	}
+	else if(now - m_LastAudioReadTime > boost::chrono::milliseconds(200))
+		return false;
+
+	unsigned int iPosition = m_pAudioFifo->getReadPosition();
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	if(!m_bAudioClockValid || m_iAudioClockSerial != m_iSerial)
+		return false;
+	int iSamples = (int)(iPosition - m_iAudioClockPosition);
+	if(iSamples < 0)
+		return false;		// the anchor moved ahead with a loop or gap the sound card hasn't reached yet
+	double dTime = m_dAudioClockTime + (double)iSamples / m_iAudioFifoSampleRate - m_dAudioLatencyInMs / 1000.0;
+	dFrames = dTime * m_dFps;
+	m_lAudioClockFrame.store((long)floor(dFrames), boost::memory_order_relaxed);
+	return true;
+}
+
+// video frames are whole steps, so up to one frame of drift is just quantization, the decoder gets lighter work while
+// the video is more than a few frames behind
+void FFmpegWrapper::updateAudioVideoDrift(double dAudioFrames)
+{
+	if(m_dFps < EPS)
+		return;
+	double dDriftFrames = m_lLastScheduledFrame - dAudioFrames;
+	if(fabs(dDriftFrames) > m_dFps * 2.0)
+		return;		// a loop wrapped the video but not the audio yet or the other way round
+	m_dAudioVideoDrift = dDriftFrames / m_dFps * 1000.0;
+	if(fabs(m_dAudioVideoDrift) > m_dMaxAudioVideoDrift)
+		m_dMaxAudioVideoDrift = fabs(m_dAudioVideoDrift);
+
+	if(dDriftFrames < -3.0)
+		m_bVideoBehindAudio.store(true, boost::memory_order_relaxed);
+	else if(dDriftFrames > -1.0)
+		m_bVideoBehindAudio.store(false, boost::memory_order_relaxed);
+}
+
+double FFmpegWrapper::calculateAudioTime(boost::int64_t lPts)
+{
+	// relative to the start of the video, that's where the frame numbers count from
+	double dTime = lPts * r2d(m_pFormatContext->streams[m_iAudioStream]->time_base);
+	AVStream* pStream = m_pFormatContext->streams[(m_iVideoStream >= 0) ? m_iVideoStream : m_iAudioStream];
+	if(pStream->start_time != s_lNoPts)
+		dTime -= pStream->start_time * r2d(pStream->time_base);
+	return dTime;
+}
+
+int FFmpegWrapper::readAudio(void* pBuffer, int iFrames)
+{
+	if(m_pAudioFifo == nullptr || iFrames <= 0)
+		return 0;
+	if(m_iState != ePlaying)
+	{
+		// silence without counting it as underrun, the read still tells the audio decoder thread to wait for us
+		m_pAudioFifo->read((unsigned char*)pBuffer, 0);
+		memset(pBuffer, 0, iFrames * m_pAudioFifo->getFrameSize());
+		return 0;
+	}
+	return m_pAudioFifo->read((unsigned char*)pBuffer, iFrames);
+}
+
+int FFmpegWrapper::getAudioBytesPerFrame()
+{
+	return (m_pAudioFifo != nullptr) ? m_pAudioFifo->getFrameSize() : 0;
+}
+
+void FFmpegWrapper::setAudioBufferSize(int iMilliSeconds)
+{
+	m_iAudioBufferSize = (iMilliSeconds < 100) ? 100 : iMilliSeconds;
+}
+
+int FFmpegWrapper::getAudioBufferSize()
+{
+	return m_iAudioBufferSize;
+}
+
+void FFmpegWrapper::setAudioOutputFormat(int iFormat, int iSampleRate, int iChannels)
+{
+	m_iAudioOutputFormat = iFormat;
+	m_iAudioOutputSampleRate = (iSampleRate < 0) ? 0 : iSampleRate;
+	m_iAudioOutputChannels = (iChannels < 0) ? 0 : iChannels;
+}
+
+int FFmpegWrapper::getAudioOutputFormat()
+{
+	return m_iAudioOutputFormat;
+}
+
+int FFmpegWrapper::getAudioOutputSampleRate()
+{
+	return m_iAudioFifoSampleRate;
+}
+
+int FFmpegWrapper::getAudioOutputChannels()
+{
+	return m_iAudioFifoChannels;
+}
+
+void FFmpegWrapper::setAudioSyncEnabled(bool bEnabled)
+{
+	m_bAudioSync = bEnabled;
+}
+
+bool FFmpegWrapper::isAudioSyncEnabled()
+{
+	return m_bAudioSync;
 }
 
-bool FFmpegWrapper::decodeFrame()
+bool FFmpegWrapper::isAudioSyncActive()
 {
-	bool bRet = false;
-	
-	for(int i=0; i<m_pFormatContext->nb_streams; i++)
-	{
-		AVPacket* pAVPacket = fetchAVPacket();
-		
-		if(pAVPacket!=nullptr)
-		{
-			// Is this a packet from the video stream?
-			if(pAVPacket->stream_index == m_iVideoStream) 
-			{
-				bRet = false;
-				bRet = decodeVideoFrame(pAVPacket);
-			}
-			else if(pAVPacket->stream_index == m_iAudioStream)
-			{
-				bRet = false;
-				bRet = decodeAudioFrame(pAVPacket);
-			}
-    
-			av_free_packet(pAVPacket);
-
-			if(!bRet)
-				return false;
-
-			
-		}
-	}
-	
-	if(!bRet)
-		printf("ficke");
-	return bRet;
+	return m_bAudioSyncActive;
 }
 
-bool FFmpegWrapper::decodeVideoFrame(AVPacket* pAVPacket)
+void FFmpegWrapper::setAudioLatency(double dLatencyInMs)
 {
-	int isFrameDecoded=0;
+	m_dAudioLatencyInMs = (dLatencyInMs < 0) ? 0 : dLatencyInMs;
+}
 
-	// Decode video frame
-	if(avcodec_decode_video2(m_pVideoCodecContext, m_pVideoFrame, &isFrameDecoded, pAVPacket)<0)
-		return false;
-			
-	// Did we get a video frame?
-	if(isFrameDecoded) 
-	{
-		//Convert YUV->RGB
-		sws_scale(m_pSwScalingContext, m_pVideoFrame->data, m_pVideoFrame->linesize, 0, getHeight(), m_pVideoFrameRGB->data, m_pVideoFrameRGB->linesize);
-		m_AVData.m_VideoData.m_pData =  m_pVideoFrameRGB->data[0];
-		m_AVData.m_VideoData.m_lPts = m_pVideoFrame->pkt_pts;
-		m_AVData.m_VideoData.m_lDts = m_pVideoFrame->pkt_dts;
-		if(m_AVData.m_VideoData.m_lPts == AV_NOPTS_VALUE)
-			m_AVData.m_VideoData.m_lPts = 0;
-		if(m_AVData.m_VideoData.m_lDts == AV_NOPTS_VALUE)
-			m_AVData.m_VideoData.m_lDts = 0;
+double FFmpegWrapper::getAudioLatency()
+{
+	return m_dAudioLatencyInMs;
+}
 
-		printf("video frame %d\n", m_AVData.m_VideoData.m_lPts);
+double FFmpegWrapper::getAudioVideoDrift()
+{
+	return m_dAudioVideoDrift;
+}
 
-		return true;
-	}
-	return false;
+double FFmpegWrapper::getMaxAudioVideoDrift()
+{
+	return m_dMaxAudioVideoDrift;
 }
 
-bool FFmpegWrapper::decodeAudioFrame(AVPacket* pAVPacket)
+PlayerStats FFmpegWrapper::getStats()
 {
-	int isFrameDecoded=0;
+	PlayerStats stats;
+	stats.m_lPacketsDemuxed = m_pCounters->m_lPacketsDemuxed.load(boost::memory_order_relaxed);
+	stats.m_lBytesDemuxed = m_pCounters->m_lBytesDemuxed.load(boost::memory_order_relaxed);
+	stats.m_lFramesDecoded = m_pCounters->m_lFramesDecoded.load(boost::memory_order_relaxed);
+	stats.m_lFramesDropped = m_pCounters->m_lFramesDropped.load(boost::memory_order_relaxed);
+	stats.m_lFramesPresented = m_pCounters->m_lFramesPresented.load(boost::memory_order_relaxed);
+	stats.m_lPacketShellAllocations = m_pPacketPool->getShellAllocationCount();
+	stats.m_lPacketPayloadAllocations = m_pPacketPool->getPayloadAllocationCount();
+	stats.m_dAudioVideoDrift = m_dAudioVideoDrift;
+	stats.m_dMaxAudioVideoDrift = m_dMaxAudioVideoDrift;
+	stats.m_iVideoPackets = m_pVideoPackets->size();		// the queues live as long as the player
+	stats.m_iAudioPackets = m_pAudioPackets->size();
+	stats.m_iReadyFrames = m_pReadyFrames->size();
+
+	// frame cache and audio fifo are replaced by open and close, they are swapped under the mutex
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	stats.m_lFrameCacheHits = (m_pFrameCache != nullptr) ? m_pFrameCache->getHitCount() : 0;
+	stats.m_lFrameCacheMisses = (m_pFrameCache != nullptr) ? m_pFrameCache->getMissCount() : 0;
+	stats.m_lAudioUnderruns = (m_pAudioFifo != nullptr) ? m_pAudioFifo->getUnderruns() : 0;
+	stats.m_lAudioOverruns = (m_pAudioFifo != nullptr) ? m_pAudioFifo->getOverruns() : 0;
+	stats.m_iAudioFrames = (m_pAudioFifo != nullptr) ? m_pAudioFifo->getBufferedFrames() : 0;
+	scopedLock.unlock();
+	stats.m_Demux = m_pCounters->m_Demux.get();
+	stats.m_VideoDecode = m_pCounters->m_VideoDecode.get();
+	stats.m_AudioDecode = m_pCounters->m_AudioDecode.get();
+	stats.m_Scale = m_pCounters->m_Scale.get();
+	stats.m_Copy = m_pCounters->m_Copy.get();
+	return stats;
+}
 
-	if(avcodec_decode_audio4(m_pAudioCodecContext, m_pAudioFrame, &isFrameDecoded, pAVPacket)<0)
-	{
-		m_AVData.m_AudioData.m_pData = nullptr;
-		return false;
-	}
-	m_AVData.m_AudioData.m_pData = m_pAudioFrame->data[0];
-	m_AVData.m_AudioData.m_lSizeInBytes = av_samples_get_buffer_size(NULL, m_pAudioCodecContext->channels, m_pAudioFrame->nb_samples, m_pAudioCodecContext->sample_fmt, 1);	// 1 stands for don't align size
-	m_AVData.m_AudioData.m_lPts = m_pAudioFrame->pkt_pts;
-	m_AVData.m_AudioData.m_lDts = m_pAudioFrame->pkt_dts;
-	if(m_AVData.m_AudioData.m_lPts == AV_NOPTS_VALUE)
-		m_AVData.m_AudioData.m_lPts = 0;
-	if(m_AVData.m_AudioData.m_lDts == AV_NOPTS_VALUE)
-		m_AVData.m_AudioData.m_lDts = 0;
+long FFmpegWrapper::getAudioUnderruns()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return (m_pAudioFifo != nullptr) ? m_pAudioFifo->getUnderruns() : 0;
+}
 
-	printf("audio frame %d\n", m_AVData.m_AudioData.m_lPts);
-	return true;
+long FFmpegWrapper::getAudioOverruns()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return (m_pAudioFifo != nullptr) ? m_pAudioFifo->getOverruns() : 0;
 }
 
 bool FFmpegWrapper::decodeImage()
@@ -573,31 +2239,70 @@ bool FFmpegWrapper::decodeImage()
 	int isFrameDecoded=-1;
 
 	AVPacket packet;
-	// alloc img buffer
-	FILE *imgFile = fopen(m_strFileName.c_str(),"rb");
-	fseek(imgFile,0,SEEK_END);
-	long imgFileSize = ftell(imgFile);
-	fseek(imgFile,0,SEEK_SET);
-	void *imgBuffer = malloc(imgFileSize);
-	fread(imgBuffer,1,imgFileSize,imgFile);
-	fclose(imgFile);
+	// the whole file is one packet, copied straight from the mapping if there is one, the decoder wants zeroed padding behind it
+	long imgFileSize = 0;
+	void *imgBuffer = nullptr;
+	if(m_pMappedFile != nullptr)
+	{
+		imgFileSize = (long)m_pMappedFile->getSize();
+		imgBuffer = av_mallocz(imgFileSize + FF_INPUT_BUFFER_PADDING_SIZE);
+		if(imgBuffer != nullptr)
+			memcpy(imgBuffer, m_pMappedFile->getData(), imgFileSize);
+	}
+	else if(m_pIOContext != nullptr)
+	{
+		// for an input source the name is just a format hint, the image is read again through the io context
+		AVIOContext* pIOContext = (AVIOContext*)m_pIOContext;
+		if(avio_seek(pIOContext, 0, SEEK_SET) < 0)
+			return false;
+		std::vector<unsigned char> data;
+		unsigned char chunk[IO_BUFFER_SIZE];
+		int iRead = 0;
+		while((iRead = avio_read(pIOContext, chunk, IO_BUFFER_SIZE)) > 0)
+			data.insert(data.end(), chunk, chunk + iRead);
+		imgFileSize = (long)data.size();
+		if(imgFileSize == 0)
+			return false;
+		imgBuffer = av_mallocz(imgFileSize + FF_INPUT_BUFFER_PADDING_SIZE);
+		if(imgBuffer != nullptr)
+			memcpy(imgBuffer, &data[0], imgFileSize);
+	}
+	else
+	{
+		FILE *imgFile = fopen(m_strFileName.c_str(),"rb");
+		if(imgFile == nullptr)
+			return false;
+		fseek(imgFile,0,SEEK_END);
+		imgFileSize = ftell(imgFile);
+		fseek(imgFile,0,SEEK_SET);
+		imgBuffer = av_mallocz(imgFileSize + FF_INPUT_BUFFER_PADDING_SIZE);
+		if(imgBuffer != nullptr)
+			fread(imgBuffer,1,imgFileSize,imgFile);
+		fclose(imgFile);
+	}
+	if(imgBuffer == nullptr)
+		return false;
 	packet.data = (uint8_t*)imgBuffer;
 	packet.size = imgFileSize;
 	av_init_packet(&packet);
 	//decode image
 	avcodec_decode_video2(m_pVideoCodecContext, m_pVideoFrame, &isFrameDecoded, &packet);
 
-	if(isFrameDecoded)	// Did we get a video frame? 
+	VideoFrame* pFrame = nullptr;
+	if(isFrameDecoded && (pFrame = convertVideoFrame(false)) != nullptr)	// Did we get a video frame? 
 	{
-		//Convert YUV->RGB
-		sws_scale(m_pSwScalingContext, m_pVideoFrame->data, m_pVideoFrame->linesize, 0, getHeight(), m_pVideoFrameRGB->data, m_pVideoFrameRGB->linesize);
+		pFrame->m_lFrameNumber = 0;
+		pFrame->m_iSerial = m_iSerial;
+		if(!m_pReadyFrames->tryPush(pFrame))
+			FramePool::release(pFrame);
+		presentNextFrame();
 		av_free_packet(&packet);
-		free(imgBuffer);			// we have to free this buffer separately don't ask me why, otherwise leak
+		av_free(imgBuffer);			// we have to free this buffer separately don't ask me why, otherwise leak
 		return true;
 	}
 	else
 	{
-		free(imgBuffer);
+		av_free(imgBuffer);
 	    av_free_packet(&packet);
 		return false;
 	}
@@ -605,25 +2310,34 @@ bool FFmpegWrapper::decodeImage()
 
 bool FFmpegWrapper::seekFrame(long lTargetFrameNumber)
 {
-	int iDirectionFlag = 0;
-	if(m_iDirection == eBackward)
-		iDirectionFlag = AVSEEK_FLAG_BACKWARD;
-	
 	int iStream = m_iVideoStream;
 	if(iStream<0)						// we just have an audio stream so seek in this stream
 		iStream = m_iAudioStream;
 
+	// with an index the keyframe in front of the target is known, the decoder then skips the frames up to the target
+	IndexEntry keyFrame;
+	if(m_iVideoStream>=0 && m_pSeekIndex!=nullptr && m_pSeekIndex->findKeyFrame(lTargetFrameNumber, keyFrame))
+	{
+		if(keyFrame.m_lPos>=0 && !(m_pFormatContext->iformat->flags & AVFMT_NO_BYTE_SEEK))
+		{
+			if(av_seek_frame(m_pFormatContext, m_iVideoStream, keyFrame.m_lPos, AVSEEK_FLAG_BYTE) >= 0)
+				return true;
+		}
+		boost::int64_t lTimestamp = (keyFrame.m_lDts != s_lNoPts) ? keyFrame.m_lDts : keyFrame.m_lPts;
+		if(lTimestamp != s_lNoPts && avformat_seek_file(m_pFormatContext, m_iVideoStream, INT64_MIN, lTimestamp, lTimestamp, 0) >= 0)
+			return true;
+	}
+
 	if(iStream>=0)
 	{
-		if(avformat_seek_file(m_pFormatContext, iStream, lTargetFrameNumber, lTargetFrameNumber, lTargetFrameNumber, AVSEEK_FLAG_FRAME | AVSEEK_FLAG_ANY | AVSEEK_FLAG_BACKWARD) < 0)
+		// without an index seek by timestamp to the keyframe at or in front of the target, not every demuxer can seek by
+		// frame and a frame seek may land on a frame that can't be decoded on its own, the decoder skips up to the target
+		// the codecs are flushed by whoever owns them, the decoder threads do so on their flush command
+		boost::int64_t lTimestamp = calculateTimestampFromFrameNumber(iStream, lTargetFrameNumber);
+		if(avformat_seek_file(m_pFormatContext, iStream, INT64_MIN, lTimestamp, lTimestamp, AVSEEK_FLAG_BACKWARD) < 0)
 		{
 			return false;
 		}
-		if( m_pVideoCodecContext != nullptr)
-			avcodec_flush_buffers(m_pVideoCodecContext);
-		if( m_pAudioCodecContext != nullptr)
-			avcodec_flush_buffers(m_pAudioCodecContext);
-	
 		return true;
 	}
 	return false;
@@ -645,10 +2359,6 @@ bool FFmpegWrapper::seekTime(double dTimeInMs)
 		{
 			return false;
 		}
-		if( m_pVideoCodecContext != nullptr)
-			avcodec_flush_buffers(m_pVideoCodecContext);
-		if( m_pAudioCodecContext != nullptr)
-			avcodec_flush_buffers(m_pAudioCodecContext);
 	
 		return true;
 	}
@@ -660,11 +2370,13 @@ bool FFmpegWrapper::seekTime(double dTimeInMs)
 void FFmpegWrapper::setFramePosition(long lTargetFrameNumber)
 {
 	m_dTargetTimeInMs = ((float)(lTargetFrameNumber) * 1.0 / m_dFps * 1000.0);
+	requestSeek(lTargetFrameNumber);
 }
 
 void FFmpegWrapper::setTimePositionInMs(double dTargetTimeInMs)
 {
 	m_dTargetTimeInMs = dTargetTimeInMs;
+	requestSeek(calculateFrameNumberFromTime(dTargetTimeInMs));
 }
 
 void FFmpegWrapper::setPosition(float fPos)
@@ -678,10 +2390,12 @@ void FFmpegWrapper::setPosition(float fPos)
 		fPos=1.0;
 	}
 	m_dTargetTimeInMs = (fPos * m_dDurationInMs);
+	requestSeek(calculateFrameNumberFromTime(m_dTargetTimeInMs));
 }
 
 void FFmpegWrapper::setLoopMode(int iLoopMode)
 {
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
 	m_iLoopMode = iLoopMode;
 }
 
@@ -692,7 +2406,270 @@ int	FFmpegWrapper::getLoopMode()
 
 void FFmpegWrapper::setSpeed(float fSpeed)	
 {
+	bool bWasKeyFramesOnly = isKeyFramesOnly();
 	m_fSpeedMultiplier = fabs(fSpeed);	// just positiv values, direction is set separately
+	publishDecodeSchedule();
+
+	// the decoder needs a clean start at a keyframe when switching between keyframes and all frames
+	if(bWasKeyFramesOnly != isKeyFramesOnly() && m_bIsThreadRunning && m_lCurrentFrameNumber >= 0)
+		requestSeek(m_lCurrentFrameNumber + m_iDirection, false);
+}
+
+void FFmpegWrapper::setRealtimeEnabled(bool bEnabled)
+{
+	m_bRealtime = bEnabled;
+}
+
+bool FFmpegWrapper::isRealtimeEnabled()
+{
+	return m_bRealtime;
+}
+
+int FFmpegWrapper::getFrameSkip()
+{
+	return (m_fSpeedMultiplier >= 2.0f) ? (int)m_fSpeedMultiplier : 1;
+}
+
+bool FFmpegWrapper::isKeyFramesOnly()
+{
+	return m_fSpeedMultiplier >= KEYFRAMES_ONLY_SPEED;
+}
+
+void FFmpegWrapper::setFrameQueueDepth(int iDepth)
+{
+	m_iFrameQueueDepth = (iDepth < 1) ? 1 : iDepth;
+}
+
+int FFmpegWrapper::getFrameQueueDepth()
+{
+	return m_iFrameQueueDepth;
+}
+
+void FFmpegWrapper::setOutputFormat(int iFormat, int iWidth, int iHeight, int iScaler)
+{
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		m_iOutputFormat = iFormat;
+		m_iOutputWidth = (iWidth < 0) ? 0 : iWidth;
+		m_iOutputHeight = (iHeight < 0) ? 0 : iHeight;
+		m_iOutputScaler = iScaler;
+	}
+	if(m_pFrameCache != nullptr)
+		m_pFrameCache->clear();		// cached frames are of the old format
+
+	// a paused player or an image shows the new format right away
+	if(!m_bIsFileOpen || !hasVideo())
+		return;
+	if(isImage())
+		decodeImage();
+	else if(m_iState != ePlaying && m_lCurrentFrameNumber >= 0)
+		requestSeek(m_lCurrentFrameNumber);
+}
+
+int FFmpegWrapper::getOutputFormat()
+{
+	return m_iOutputFormat;
+}
+
+int FFmpegWrapper::getOutputScaler()
+{
+	return m_iOutputScaler;
+}
+
+void FFmpegWrapper::setOutputRowAlignment(int iBytes)
+{
+	int iAlignment = 0;
+	if(iBytes > 1)
+	{
+		// next power of two
+		iAlignment = 1;
+		while(iAlignment < iBytes && iAlignment < 256)
+			iAlignment <<= 1;
+	}
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		m_iOutputRowAlignment = iAlignment;
+	}
+	setOutputFormat(m_iOutputFormat, m_iOutputWidth, m_iOutputHeight, m_iOutputScaler);	// shows the new layout like a format change
+}
+
+int FFmpegWrapper::getOutputRowAlignment()
+{
+	return m_iOutputRowAlignment;
+}
+
+void FFmpegWrapper::setPacketQueueDepth(int iDepth)
+{
+	m_iPacketQueueDepth = (iDepth < 1) ? 1 : iDepth;
+}
+
+int FFmpegWrapper::getPacketQueueDepth()
+{
+	return m_iPacketQueueDepth;
+}
+
+void FFmpegWrapper::setFileMappingEnabled(bool bEnabled)
+{
+	m_bFileMapping = bEnabled;
+}
+
+bool FFmpegWrapper::isFileMappingEnabled()
+{
+	return m_bFileMapping;
+}
+
+bool FFmpegWrapper::isFileMapped()
+{
+	return m_pMappedFile != nullptr;
+}
+
+void FFmpegWrapper::setReadAhead(int iHint, int iWindowInKB)
+{
+	m_iReadAheadHint = iHint;
+	m_iReadAheadWindow = (iWindowInKB < 0) ? 0 : iWindowInKB;
+}
+
+int FFmpegWrapper::getReadAheadHint()
+{
+	return m_iReadAheadHint;
+}
+
+int FFmpegWrapper::getReadAheadWindow()
+{
+	return m_iReadAheadWindow;
+}
+
+void FFmpegWrapper::setProbeSize(int iBytes)
+{
+	m_iProbeSize = (iBytes < 0) ? 0 : iBytes;
+}
+
+int FFmpegWrapper::getProbeSize()
+{
+	return m_iProbeSize;
+}
+
+void FFmpegWrapper::setAnalyzeDuration(int iMilliSeconds)
+{
+	m_iAnalyzeDuration = (iMilliSeconds < 0) ? 0 : iMilliSeconds;
+}
+
+int FFmpegWrapper::getAnalyzeDuration()
+{
+	return m_iAnalyzeDuration;
+}
+
+void FFmpegWrapper::setFastStartEnabled(bool bEnabled)
+{
+	m_bFastStart = bEnabled;
+}
+
+bool FFmpegWrapper::isFastStartEnabled()
+{
+	return m_bFastStart;
+}
+
+bool FFmpegWrapper::isFastStarted()
+{
+	return m_bFastStarted;
+}
+
+void FFmpegWrapper::setSeekIndexEnabled(bool bEnabled)
+{
+	m_bSeekIndexEnabled = bEnabled;
+}
+
+bool FFmpegWrapper::isSeekIndexEnabled()
+{
+	return m_bSeekIndexEnabled;
+}
+
+bool FFmpegWrapper::isSeekIndexComplete()
+{
+	return m_pSeekIndex != nullptr && m_pSeekIndex->isComplete();
+}
+
+void FFmpegWrapper::setSeekIndexCacheDirectory(const std::string& strDirectory)
+{
+	boost::mutex::scoped_lock scopedLock(s_CacheMutex);
+	s_strSeekIndexCacheDirectory = strDirectory;
+}
+
+std::string FFmpegWrapper::getSeekIndexCacheDirectory()
+{
+	boost::mutex::scoped_lock scopedLock(s_CacheMutex);
+	return s_strSeekIndexCacheDirectory;
+}
+
+void FFmpegWrapper::setDecoderThreads(int iThreadCount, int iThreadType)
+{
+	m_iDecoderThreads = (iThreadCount < 0) ? 0 : iThreadCount;
+	m_iDecoderThreadType = iThreadType;
+}
+
+int FFmpegWrapper::getDecoderThreads()
+{
+	return m_iReservedThreads;
+}
+
+int FFmpegWrapper::getDecoderThreadType()
+{
+	return (m_pVideoCodecContext != nullptr) ? m_pVideoCodecContext->active_thread_type : m_iDecoderThreadType;
+}
+
+void FFmpegWrapper::setDefaultDecoderThreads(int iThreadCount, int iThreadType)
+{
+	boost::mutex::scoped_lock scopedLock(s_ThreadBudgetMutex);
+	s_iDefaultDecoderThreads = (iThreadCount < 0) ? 0 : iThreadCount;
+	s_iDefaultDecoderThreadType = iThreadType;
+}
+
+void FFmpegWrapper::setDecoderCoreBudget(int iCores)
+{
+	boost::mutex::scoped_lock scopedLock(s_ThreadBudgetMutex);
+	s_iDecoderCoreBudget = (iCores < 0) ? 0 : iCores;
+}
+
+int FFmpegWrapper::getDecoderCoreBudget()
+{
+	boost::mutex::scoped_lock scopedLock(s_ThreadBudgetMutex);
+	return getCoreBudget();
+}
+
+int FFmpegWrapper::getDecoderThreadsInUse()
+{
+	boost::mutex::scoped_lock scopedLock(s_ThreadBudgetMutex);
+	return s_iDecoderThreadsInUse;
+}
+
+void FFmpegWrapper::setBackwardCacheSize(int iFrames)
+{
+	m_iBackwardCacheFrames = (iFrames < 1) ? 1 : iFrames;
+}
+
+int FFmpegWrapper::getBackwardCacheSize()
+{
+	return m_iBackwardCacheFrames;
+}
+
+void FFmpegWrapper::setFrameCacheSize(int iMegaBytes)
+{
+	m_iFrameCacheSize = (iMegaBytes < 0) ? 0 : iMegaBytes;
+}
+
+int FFmpegWrapper::getFrameCacheSize()
+{
+	return m_iFrameCacheSize;
+}
+
+unsigned int FFmpegWrapper::getSourceWidth()
+{
+	return (m_pVideoCodecContext != nullptr) ? m_pVideoCodecContext->width : 0;
+}
+
+unsigned int FFmpegWrapper::getSourceHeight()
+{
+	return (m_pVideoCodecContext != nullptr) ? m_pVideoCodecContext->height : 0;
 }
 
 unsigned int FFmpegWrapper::getWidth()
@@ -705,8 +2682,31 @@ unsigned int FFmpegWrapper::getHeight()
 	return m_AVData.m_VideoData.m_iHeight;
 }
 
+void FFmpegWrapper::setVisible(bool bVisible)
+{
+	m_bVisible = bVisible;
+	publishDecodeSchedule();
+	if(bVisible && m_pGroup != nullptr)
+		m_pGroup->wake();
+}
+
+bool FFmpegWrapper::isVisible()
+{
+	return m_bVisible;
+}
+
+PlayerGroup* FFmpegWrapper::getPlayerGroup()
+{
+	return m_pGroup;
+}
+
 int FFmpegWrapper::getState()
 {
+	{
+		boost::mutex::scoped_lock scopedLock(m_OpenMutex);
+		if(m_bOpening)
+			return eOpening;
+	}
 	return m_iState;
 }
 
@@ -732,7 +2732,7 @@ long FFmpegWrapper::getCurrentFrameNumber()
 
 double FFmpegWrapper::getCurrentTimeInMs()
 {
-	return m_dTargetTimeInMs;
+	return (m_dCurrentTimeInMs < 0) ? 0 : m_dCurrentTimeInMs;
 }
 
 unsigned long FFmpegWrapper::getDurationInFrames()
@@ -752,7 +2752,15 @@ int	FFmpegWrapper::getDirection()
 
 void FFmpegWrapper::setDirection(int iDirection)
 {
-	m_iDirection = iDirection;
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		if(m_iDirection == iDirection)
+			return;
+		m_iDirection = iDirection;
+	}
+	// restart the pipeline next to the shown frame, otherwise the frames already queued would play out first
+	if(m_bIsThreadRunning && m_lCurrentFrameNumber >= 0)
+		requestSeek(m_lCurrentFrameNumber + iDirection);
 }
 
 std::string FFmpegWrapper::getVideoCodecName()
@@ -793,8 +2801,9 @@ bool FFmpegWrapper::hasAudio()
 bool FFmpegWrapper::isNewFrame()
 {
 	update();
-	long lTargetFrame = calculateFrameNumberFromTime(m_dTargetTimeInMs);
-	return (lTargetFrame != m_lCurrentFrameNumber);
+	bool bNewFrame = m_bNewFrame;
+	m_bNewFrame = false;
+	return bNewFrame;
 }
 
 void FFmpegWrapper::retrieveFileInfo()
@@ -844,9 +2853,10 @@ void FFmpegWrapper::dumpFFmpegInfo()
 	std::cout << "AVFormat configuration: " << avformat_configuration() << std::endl << std::endl;
 }
 
+// monotonic, so adjusting the system time doesn't make the player jump
 double FFmpegWrapper::getDeltaTime()
 {
-	boost::chrono::system_clock::time_point newTime = boost::chrono::system_clock::now();
+	boost::chrono::steady_clock::time_point newTime = boost::chrono::steady_clock::now();
 	boost::chrono::duration<double> delta = newTime - m_OldTime; 
 	m_OldTime = newTime;
 	return delta.count() * 1000.0;
@@ -858,6 +2868,33 @@ long FFmpegWrapper::calculateFrameNumberFromTime(long lTime)
 	return lTargetFrame;
 }
 
+long FFmpegWrapper::calculateFrameNumberFromPacket(AVPacket* pAVPacket)
+{
+	int64_t lTimestamp = (pAVPacket->pts != s_lNoPts) ? pAVPacket->pts : pAVPacket->dts;
+	if(lTimestamp == s_lNoPts)
+		return -1;
+	return calculateFrameNumberFromPts(lTimestamp);
+}
+
+long FFmpegWrapper::calculateFrameNumberFromPts(boost::int64_t lPts)
+{
+	AVStream* pStream = m_pFormatContext->streams[m_iVideoStream];
+	if(pStream->start_time != s_lNoPts)
+		lPts -= pStream->start_time;
+	return (long)floor(lPts * r2d(pStream->time_base) * m_dFps + 0.5);
+}
+
+// start of the frame in the time base of the stream, the inverse of calculateFrameNumberFromPts
+boost::int64_t FFmpegWrapper::calculateTimestampFromFrameNumber(int iStream, long lFrameNumber)
+{
+	AVStream* pStream = m_pFormatContext->streams[iStream];
+	double dTime = (m_dFps > EPS) ? lFrameNumber / m_dFps : 0;
+	boost::int64_t lTimestamp = (boost::int64_t)floor(dTime / r2d(pStream->time_base) + 0.5);
+	if(pStream->start_time != s_lNoPts)
+		lTimestamp += pStream->start_time;
+	return lTimestamp;
+}
+
 double FFmpegWrapper::mod(double a, double b)
 {
 	int result = static_cast<int>( a / b );
@@ -869,6 +2906,25 @@ bool FFmpegWrapper::isImage()
 	return m_iBitrate<=0 && m_AVData.m_AudioData.m_iSampleRate<=0;
 }
 
+int FFmpegWrapper::getChannelCount(int iPixelFormat)
+{
+	switch(iPixelFormat)
+	{
+		case PIX_FMT_RGB24:
+		case PIX_FMT_BGR24:
+			return 3;
+		case PIX_FMT_RGBA:
+		case PIX_FMT_BGRA:
+		case PIX_FMT_ARGB:
+		case PIX_FMT_ABGR:
+			return 4;
+		case PIX_FMT_GRAY8:
+			return 1;
+		default:
+			return 0;	// planar, see m_iPixelFormat
+	}
+}
+
 // helper function as taken from OpenCV ffmpeg reader
 double FFmpegWrapper::r2d(AVRational r)
 {
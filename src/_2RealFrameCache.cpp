@@ -0,0 +1,190 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This wrapper uses FFmpeg, and is licensed and credited as follows:
+
+	 * copyright (c) 2001 Fabrice Bellard
+	 *
+	 * This  FFmpeg.
+	 *
+	 * FFmpeg is free software; you can redistribute it and/or
+	 * modify it under the terms of the GNU Lesser General Public
+	 * License as published by the Free Software Foundation; either
+	 * version 2.1 of the License, or (at your option) any later version.
+	 *
+	 * FFmpeg is distributed in the hope that it will be useful,
+	 * but WITHOUT ANY WARRANTY; without even the implied warranty of
+	 * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	 * Lesser General Public License for more details.
+	 *
+	 * You should have received a copy of the GNU Lesser General Public
+	 * License along with FFmpeg; if not, write to the Free Software
+	 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA	 
+*/
+
+#include "_2RealFrameCache.h"
+#include "_2RealFramePool.h"
+
+namespace _2RealFFmpegWrapper
+{
+
+FrameCache::FrameCache(boost::int64_t lMaxBytes) : m_lMaxBytes(lMaxBytes), m_lBytes(0), m_lHits(0), m_lMisses(0)
+{
+}
+
+FrameCache::~FrameCache()
+{
+	clear();
+}
+
+void FrameCache::insert(VideoFrame* pFrame)
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	std::map<long, Entry>::iterator it = m_Frames.find(pFrame->m_lFrameNumber);
+	if(it != m_Frames.end())
+	{
+		if(it->second.m_pFrame == pFrame)	// served from the cache and queued again
+		{
+			touch(it->second);
+			return;
+		}
+		m_lBytes -= it->second.m_lBytes;
+		FramePool::release(it->second.m_pFrame);
+		m_Recent.erase(it->second.m_itUse);
+		m_Frames.erase(it);
+	}
+
+	Entry entry;
+	entry.m_pFrame = pFrame;
+	entry.m_lBytes = pFrame->m_pPool->getBufferSize();
+	entry.m_itUse = m_Recent.insert(m_Recent.begin(), pFrame->m_lFrameNumber);
+	FramePool::addRef(pFrame);
+	m_Frames[pFrame->m_lFrameNumber] = entry;
+	m_lBytes += entry.m_lBytes;
+	evict();
+}
+
+VideoFrame* FrameCache::lookup(long lFrameNumber)
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	std::map<long, Entry>::iterator it = m_Frames.find(lFrameNumber);
+	if(it == m_Frames.end())
+	{
+		m_lMisses++;
+		return nullptr;
+	}
+	m_lHits++;
+	touch(it->second);
+	FramePool::addRef(it->second.m_pFrame);
+	return it->second.m_pFrame;
+}
+
+long FrameCache::findRun(long lFirstFrame, int iDirection, int iMaxFrames)
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	long lLastFrame = -1;
+	for(int i=0; i<iMaxFrames; i++)
+	{
+		long lFrameNumber = lFirstFrame + i * iDirection;
+		if(lFrameNumber < 0 || m_Frames.find(lFrameNumber) == m_Frames.end())
+			break;
+		lLastFrame = lFrameNumber;
+	}
+	return lLastFrame;
+}
+
+int FrameCache::collect(long lFirstFrame, long lLastFrame, std::vector<VideoFrame*>& frames)
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	int iDirection = (lLastFrame < lFirstFrame) ? -1 : 1;
+	int iCount = 0;
+	for(long lFrameNumber = lFirstFrame; lFrameNumber != lLastFrame + iDirection; lFrameNumber += iDirection)
+	{
+		std::map<long, Entry>::iterator it = m_Frames.find(lFrameNumber);
+		if(it == m_Frames.end())
+			break;		// evicted in the meantime
+		m_lHits++;
+		touch(it->second);
+		FramePool::addRef(it->second.m_pFrame);
+		frames.push_back(it->second.m_pFrame);
+		iCount++;
+	}
+	return iCount;
+}
+
+void FrameCache::clear()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	for(std::map<long, Entry>::iterator it = m_Frames.begin(); it != m_Frames.end(); ++it)
+		FramePool::release(it->second.m_pFrame);
+	m_Frames.clear();
+	m_Recent.clear();
+	m_lBytes = 0;
+}
+
+int FrameCache::getFrameCount()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return (int)m_Frames.size();
+}
+
+boost::int64_t FrameCache::getByteSize()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return m_lBytes;
+}
+
+long FrameCache::getHitCount()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return m_lHits;
+}
+
+long FrameCache::getMissCount()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return m_lMisses;
+}
+
+// moves the frame to the front of the use list, splice keeps every stored iterator valid
+void FrameCache::touch(Entry& entry)
+{
+	m_Recent.splice(m_Recent.begin(), m_Recent, entry.m_itUse);
+}
+
+// the least recently used frames are at the back of the list, so every eviction is a single lookup
+void FrameCache::evict()
+{
+	while(m_lBytes > m_lMaxBytes && !m_Recent.empty())
+	{
+		std::map<long, Entry>::iterator itOldest = m_Frames.find(m_Recent.back());
+		m_Recent.pop_back();
+		m_lBytes -= itOldest->second.m_lBytes;
+		FramePool::release(itOldest->second.m_pFrame);
+		m_Frames.erase(itOldest);
+	}
+}
+
+};
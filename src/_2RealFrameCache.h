@@ -0,0 +1,77 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+*/
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+
+namespace _2RealFFmpegWrapper
+{
+	struct VideoFrame;
+
+	// decoded and converted frames by frame number, so scrubbing back and forth or looping over a short range doesn't
+	// decode the same frames again, holds a reference to every cached frame and drops the least recently used ones
+	// as soon as the frames take more than the given number of bytes
+	class FrameCache
+	{
+	public:
+		FrameCache(boost::int64_t lMaxBytes);
+		~FrameCache();
+
+		void			insert(VideoFrame* pFrame);
+		VideoFrame*		lookup(long lFrameNumber);		// with an added reference, nullptr if not cached
+		long			findRun(long lFirstFrame, int iDirection, int iMaxFrames);	// last frame of the cached frames following lFirstFrame in iDirection, -1 if lFirstFrame isn't cached
+		int				collect(long lFirstFrame, long lLastFrame, std::vector<VideoFrame*>& frames);	// appends in order from first to last with added references, stops at the first missing one
+		void			clear();
+		int				getFrameCount();
+		boost::int64_t	getByteSize();
+		long			getHitCount();
+		long			getMissCount();
+
+	private:
+		struct Entry
+		{
+			VideoFrame*					m_pFrame;
+			boost::int64_t				m_lBytes;
+			std::list<long>::iterator	m_itUse;		// position in m_Recent
+		};
+
+		void			touch(Entry& entry);
+		void			evict();
+
+		std::map<long, Entry>	m_Frames;
+		std::list<long>			m_Recent;		// frame numbers, most recently used first
+		boost::mutex			m_Mutex;
+		boost::int64_t			m_lMaxBytes;
+		boost::int64_t			m_lBytes;
+		long					m_lHits;
+		long					m_lMisses;
+	};
+};
@@ -0,0 +1,289 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This wrapper uses FFmpeg, and is licensed and credited as follows:
+
+	 * copyright (c) 2001 Fabrice Bellard
+	 *
+	 * This  FFmpeg.
+	 *
+	 * FFmpeg is free software; you can redistribute it and/or
+	 * modify it under the terms of the GNU Lesser General Public
+	 * License as published by the Free Software Foundation; either
+	 * version 2.1 of the License, or (at your option) any later version.
+	 *
+	 * FFmpeg is distributed in the hope that it will be useful,
+	 * but WITHOUT ANY WARRANTY; without even the implied warranty of
+	 * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	 * Lesser General Public License for more details.
+	 *
+	 * You should have received a copy of the GNU Lesser General Public
+	 * License along with FFmpeg; if not, write to the Free Software
+	 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA	 
+*/
+
+#include "_2RealFFmpegWrapper.h"
+#include "_2RealFramePool.h"
+
+// ffmpeg includes
+extern "C" {
+	#define __STDC_CONSTANT_MACROS
+	#include "stdint.h"
+	#include "libavcodec/avcodec.h"
+	#include "libavutil/avutil.h"
+	#include "libavutil/mem.h"
+	#include "libavutil/imgutils.h"
+}
+
+namespace _2RealFFmpegWrapper
+{
+
+FramePool::FramePool() : m_iFrames(0), m_iMaxFrames(0), m_iWidth(0), m_iHeight(0), m_iPixelFormat(PIX_FMT_NONE), m_iRowAlignment(0), m_iBufferSize(0), m_lAllocations(0), m_bShutdown(false)
+{
+}
+
+FramePool::~FramePool()
+{
+}
+
+bool FramePool::allocate(int iFrames, int iMaxFrames, int iWidth, int iHeight, int iPixelFormat, int iRowAlignment)
+{
+	m_iWidth = iWidth;
+	m_iHeight = iHeight;
+	m_iPixelFormat = iPixelFormat;
+	m_iRowAlignment = (iRowAlignment > 1) ? iRowAlignment : 0;
+	if(av_image_fill_linesizes(m_iLinesizes, (PixelFormat)iPixelFormat, iWidth) < 0)
+		return false;
+	for(int i=0; i<4 && m_iRowAlignment > 0; i++)
+		m_iLinesizes[i] = (m_iLinesizes[i] + m_iRowAlignment - 1) & ~(m_iRowAlignment - 1);
+	uint8_t* pPlanes[4];
+	m_iBufferSize = av_image_fill_pointers(pPlanes, (PixelFormat)iPixelFormat, iHeight, nullptr, m_iLinesizes);
+	if(m_iBufferSize<=0)
+		return false;
+
+	m_iMaxFrames = (iMaxFrames < iFrames) ? iFrames : iMaxFrames;
+	m_FreeFrames.setCapacity(m_iMaxFrames);
+	for(int i=0; i<iFrames; i++)
+	{
+		VideoFrame* pFrame = allocateFrame();
+		if(pFrame == nullptr)
+			return false;
+		m_FreeFrames.tryPush(pFrame);
+	}
+	return true;
+}
+
+VideoFrame* FramePool::allocateFrame()
+{
+	// av_malloc aligns for the simd code in swscale, alignments beyond that are done within the buffer
+	unsigned char* pBuffer = (unsigned char*)av_malloc(m_iBufferSize + m_iRowAlignment);
+	if(pBuffer == nullptr)
+		return nullptr;
+
+	VideoFrame* pFrame = new VideoFrame();
+	unsigned char* pStart = pBuffer;
+	if(m_iRowAlignment > 0)
+		pStart = (unsigned char*)(((size_t)pBuffer + m_iRowAlignment - 1) & ~(size_t)(m_iRowAlignment - 1));
+	uint8_t* pPlanes[4];
+	av_image_fill_pointers(pPlanes, (PixelFormat)m_iPixelFormat, m_iHeight, pStart, m_iLinesizes);
+	pFrame->m_pBuffer = pBuffer;
+	for(int i=0; i<4; i++)
+	{
+		pFrame->m_pPlanes[i] = pPlanes[i];
+		pFrame->m_iLinesizes[i] = m_iLinesizes[i];
+	}
+	pFrame->m_iWidth = m_iWidth;
+	pFrame->m_iHeight = m_iHeight;
+	pFrame->m_iPixelFormat = m_iPixelFormat;
+	pFrame->m_lFrameNumber = -1;
+	pFrame->m_lPts = pFrame->m_lDts = 0;
+	pFrame->m_iSerial = 0;
+	pFrame->m_iRefCount = 0;
+	pFrame->m_pPool = this;
+	m_iFrames++;
+	m_lAllocations++;
+	return pFrame;
+}
+
+void FramePool::freeFrame(VideoFrame* pFrame)
+{
+	av_free(pFrame->m_pBuffer);
+	delete pFrame;
+	m_iFrames--;
+}
+
+VideoFrame* FramePool::acquire()
+{
+	VideoFrame* pFrame = tryAcquire();
+	if(pFrame == nullptr)
+	{
+		if(!m_FreeFrames.pop(pFrame))	// blocks until a frame is released
+			return nullptr;
+		pFrame->m_iRefCount = 1;
+	}
+	return pFrame;
+}
+
+VideoFrame* FramePool::tryAcquire()
+{
+	VideoFrame* pFrame = nullptr;
+	if(!m_FreeFrames.tryPop(pFrame))
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		if(m_bShutdown || m_iFrames >= m_iMaxFrames)
+			return nullptr;
+		pFrame = allocateFrame();
+		if(pFrame == nullptr)
+			return nullptr;
+	}
+	pFrame->m_iRefCount = 1;
+	return pFrame;
+}
+
+void FramePool::abort()
+{
+	m_FreeFrames.abort();
+}
+
+void FramePool::reset()
+{
+	m_FreeFrames.reset();
+}
+
+void FramePool::shutdown()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_bShutdown = true;
+	m_FreeFrames.abort();
+
+	VideoFrame* pFrame = nullptr;
+	while(m_FreeFrames.tryPop(pFrame))
+		freeFrame(pFrame);
+
+	bool bDelete = (m_iFrames == 0);	// otherwise the last released frame deletes the pool
+	scopedLock.unlock();
+	if(bDelete)
+		delete this;
+}
+
+void FramePool::recycle(VideoFrame* pFrame)
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	if(!m_bShutdown)
+	{
+		m_FreeFrames.tryPush(pFrame);
+		return;
+	}
+
+	freeFrame(pFrame);
+	bool bDelete = (m_iFrames == 0);
+	scopedLock.unlock();
+	if(bDelete)
+		delete this;
+}
+
+int FramePool::getFrameCount()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return m_iFrames;
+}
+
+long FramePool::getAllocationCount()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return m_lAllocations;
+}
+
+int FramePool::getBufferSize()
+{
+	return m_iBufferSize;
+}
+
+void FramePool::addRef(VideoFrame* pFrame)
+{
+	pFrame->m_iRefCount.fetch_add(1, boost::memory_order_relaxed);
+}
+
+void FramePool::release(VideoFrame* pFrame)
+{
+	if(pFrame->m_iRefCount.fetch_sub(1, boost::memory_order_acq_rel) == 1)
+		pFrame->m_pPool->recycle(pFrame);
+}
+
+FrameHandle::FrameHandle() : m_pFrame(nullptr)
+{
+}
+
+FrameHandle::FrameHandle(VideoFrame* pFrame) : m_pFrame(pFrame)
+{
+	if(m_pFrame != nullptr)
+		FramePool::addRef(m_pFrame);
+}
+
+FrameHandle::FrameHandle(const FrameHandle& other) : m_pFrame(other.m_pFrame)
+{
+	if(m_pFrame != nullptr)
+		FramePool::addRef(m_pFrame);
+}
+
+FrameHandle::~FrameHandle()
+{
+	reset();
+}
+
+FrameHandle& FrameHandle::operator=(const FrameHandle& other)
+{
+	if(other.m_pFrame != nullptr)
+		FramePool::addRef(other.m_pFrame);
+	reset();
+	m_pFrame = other.m_pFrame;
+	return *this;
+}
+
+void FrameHandle::reset()
+{
+	if(m_pFrame != nullptr)
+	{
+		FramePool::release(m_pFrame);
+		m_pFrame = nullptr;
+	}
+}
+
+bool FrameHandle::isValid() const
+{
+	return m_pFrame != nullptr;
+}
+
+unsigned char* FrameHandle::getData() const
+{
+	return (m_pFrame != nullptr) ? m_pFrame->m_pPlanes[0] : nullptr;
+}
+
+long FrameHandle::getFrameNumber() const
+{
+	return (m_pFrame != nullptr) ? m_pFrame->m_lFrameNumber : -1;
+}
+
+};
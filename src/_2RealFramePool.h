@@ -0,0 +1,95 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+*/
+
+#pragma once
+
+#include "_2RealBoundedQueue.h"
+#include <boost/atomic.hpp>
+
+namespace _2RealFFmpegWrapper
+{
+	class FramePool;
+
+	// one decoded and converted picture, owned by a FramePool and handed around by reference count
+	struct VideoFrame
+	{
+		unsigned char*		m_pBuffer;			// aligned allocation holding all planes
+		unsigned char*		m_pPlanes[4];
+		int					m_iLinesizes[4];
+		int					m_iWidth;
+		int					m_iHeight;
+		int					m_iPixelFormat;
+		long				m_lFrameNumber;
+		long				m_lPts;
+		long				m_lDts;
+		int					m_iSerial;
+		boost::atomic<int>	m_iRefCount;
+		FramePool*			m_pPool;
+	};
+
+	// fixed size frame buffers for one output format, allocated up front so steady state playback never touches the heap
+	// a frame returns to the pool when its last reference is released, the pool deletes itself once it was shut down by
+	// its owner and the last frame came back, so handles may safely outlive the player
+	class FramePool
+	{
+	public:
+		FramePool();
+
+		// iFrames are allocated right away, up to iMaxFrames more are allocated when clients keep handles for a longer time
+		// rows start at multiples of iRowAlignment, a power of two, 0 or 1 packs them tightly
+		bool			allocate(int iFrames, int iMaxFrames, int iWidth, int iHeight, int iPixelFormat, int iRowAlignment = 0);
+		VideoFrame*		acquire();				// blocks while all frames are in use, returns nullptr when aborted, refcount is 1
+		VideoFrame*		tryAcquire();
+		void			abort();
+		void			reset();
+		void			shutdown();				// called by the owner instead of delete
+		int				getFrameCount();
+		long			getAllocationCount();	// number of frame allocations since the pool was created
+		int				getBufferSize();
+
+		static void		addRef(VideoFrame* pFrame);
+		static void		release(VideoFrame* pFrame);
+
+	private:
+		~FramePool();
+		VideoFrame*		allocateFrame();
+		void			freeFrame(VideoFrame* pFrame);
+		void			recycle(VideoFrame* pFrame);
+
+		BoundedQueue<VideoFrame*>	m_FreeFrames;
+		boost::mutex				m_Mutex;
+		int							m_iFrames;
+		int							m_iMaxFrames;
+		int							m_iWidth;
+		int							m_iHeight;
+		int							m_iPixelFormat;
+		int							m_iRowAlignment;
+		int							m_iLinesizes[4];
+		int							m_iBufferSize;
+		long						m_lAllocations;
+		bool						m_bShutdown;
+	};
+};
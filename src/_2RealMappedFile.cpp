@@ -0,0 +1,333 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This wrapper uses FFmpeg, and is licensed and credited as follows:
+
+	 * copyright (c) 2001 Fabrice Bellard
+	 *
+	 * This  FFmpeg.
+	 *
+	 * FFmpeg is free software; you can redistribute it and/or
+	 * modify it under the terms of the GNU Lesser General Public
+	 * License as published by the Free Software Foundation; either
+	 * version 2.1 of the License, or (at your option) any later version.
+	 *
+	 * FFmpeg is distributed in the hope that it will be useful,
+	 * but WITHOUT ANY WARRANTY; without even the implied warranty of
+	 * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	 * Lesser General Public License for more details.
+	 *
+	 * You should have received a copy of the GNU Lesser General Public
+	 * License along with FFmpeg; if not, write to the Free Software
+	 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA	 
+*/
+
+#include "_2RealMappedFile.h"
+#include "_2RealFFmpegWrapper.h"
+#include <cstring>
+
+#ifdef _WIN32
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#ifdef __linux__
+		#include <sys/vfs.h>
+	#else
+		#include <sys/param.h>
+		#include <sys/mount.h>
+	#endif
+#endif
+
+extern "C"
+{
+	#include "libavformat/avformat.h"
+	#include "libavutil/mem.h"
+}
+
+namespace _2RealFFmpegWrapper
+{
+
+static const int IO_BUFFER_SIZE = 32768;
+
+struct MappedFile::Reader
+{
+	MappedFile*			m_pFile;
+	boost::int64_t		m_lPosition;
+	boost::int64_t		m_lPrefetched;		// end of the range prefetched for this reader
+};
+
+MappedFile::MappedFile() : m_pData(nullptr), m_lSize(0), m_iReadAheadWindow(0), m_hFile(nullptr), m_hMapping(nullptr), m_bMapped(false)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& strFileName, int iReadAheadHint, int iReadAheadWindow)
+{
+	close();
+	m_iReadAheadWindow = (iReadAheadWindow < 0) ? 0 : iReadAheadWindow;
+
+#ifdef _WIN32
+	// the hints are flags of the file handle on windows, they steer the cache manager's readahead for the mapping too
+	DWORD iFlags = FILE_ATTRIBUTE_NORMAL;
+	if(iReadAheadHint == eReadAheadSequential)
+		iFlags |= FILE_FLAG_SEQUENTIAL_SCAN;
+	else if(iReadAheadHint == eReadAheadRandom)
+		iFlags |= FILE_FLAG_RANDOM_ACCESS;
+	if(!isOnLocalDisk(strFileName, -1))
+		return false;
+	HANDLE hFile = CreateFileA(strFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, iFlags, NULL);
+	if(hFile == INVALID_HANDLE_VALUE)
+		return false;
+	m_hFile = hFile;
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx(hFile, &size) || size.QuadPart <= 0 || (boost::uint64_t)size.QuadPart > (size_t)-1)
+	{
+		close();
+		return false;		// empty, or too large for the address space of a 32 bit process
+	}
+	m_hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if(m_hMapping == nullptr)
+	{
+		close();
+		return false;
+	}
+	m_pData = (const unsigned char*)MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0);
+	if(m_pData == nullptr)
+	{
+		close();
+		return false;
+	}
+	m_lSize = size.QuadPart;
+	m_bMapped = true;
+#else
+	int iFile = ::open(strFileName.c_str(), O_RDONLY);
+	if(iFile < 0)
+		return false;
+	struct stat status;
+	if(!isOnLocalDisk(strFileName, iFile) || fstat(iFile, &status) != 0 || status.st_size <= 0 || (boost::uint64_t)status.st_size > (size_t)-1)
+	{
+		::close(iFile);
+		return false;
+	}
+	void* pData = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_PRIVATE, iFile, 0);
+	::close(iFile);		// the mapping keeps the file open
+	if(pData == MAP_FAILED)
+		return false;
+
+	int iAdvice = MADV_NORMAL;
+	if(iReadAheadHint == eReadAheadSequential)
+		iAdvice = MADV_SEQUENTIAL;
+	else if(iReadAheadHint == eReadAheadRandom)
+		iAdvice = MADV_RANDOM;
+	madvise(pData, (size_t)status.st_size, iAdvice);
+	m_pData = (const unsigned char*)pData;
+	m_lSize = status.st_size;
+	m_bMapped = true;
+#endif
+	return true;
+}
+
+void MappedFile::attach(const unsigned char* pData, boost::int64_t lSize)
+{
+	close();
+	m_pData = pData;
+	m_lSize = lSize;
+	m_iReadAheadWindow = 0;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if(m_pData != nullptr && m_bMapped)
+		UnmapViewOfFile(m_pData);
+	if(m_hMapping != nullptr)
+		CloseHandle(m_hMapping);
+	if(m_hFile != nullptr)
+		CloseHandle(m_hFile);
+#else
+	if(m_pData != nullptr && m_bMapped)
+		munmap((void*)m_pData, (size_t)m_lSize);
+#endif
+	m_pData = nullptr;
+	m_bMapped = false;
+	m_hMapping = m_hFile = nullptr;
+	m_lSize = 0;
+}
+
+bool MappedFile::isOpen()
+{
+	return m_pData != nullptr;
+}
+
+const unsigned char* MappedFile::getData()
+{
+	return m_pData;
+}
+
+boost::int64_t MappedFile::getSize()
+{
+	return m_lSize;
+}
+
+void MappedFile::prefetch(boost::int64_t lOffset, boost::int64_t lLength)
+{
+#ifndef _WIN32
+	if(m_pData == nullptr || lOffset >= m_lSize)
+		return;
+	if(lOffset + lLength > m_lSize)
+		lLength = m_lSize - lOffset;
+	long lPageSize = sysconf(_SC_PAGESIZE);
+	boost::int64_t lStart = lOffset - lOffset % lPageSize;		// madvise wants page aligned addresses
+	madvise((void*)(m_pData + lStart), (size_t)(lOffset + lLength - lStart), MADV_WILLNEED);
+#endif
+}
+
+AVIOContext* MappedFile::createIOContext()
+{
+	if(m_pData == nullptr)
+		return nullptr;
+	unsigned char* pBuffer = (unsigned char*)av_malloc(IO_BUFFER_SIZE);
+	if(pBuffer == nullptr)
+		return nullptr;
+
+	Reader* pReader = new Reader();
+	pReader->m_pFile = this;
+	pReader->m_lPosition = 0;
+	pReader->m_lPrefetched = 0;
+	AVIOContext* pContext = avio_alloc_context(pBuffer, IO_BUFFER_SIZE, 0, pReader, &MappedFile::read, nullptr, &MappedFile::seek);
+	if(pContext == nullptr)
+	{
+		av_free(pBuffer);
+		delete pReader;
+		return nullptr;
+	}
+	pContext->seekable = AVIO_SEEKABLE_NORMAL;
+	return pContext;
+}
+
+void MappedFile::freeIOContext(AVIOContext* pContext)
+{
+	if(pContext == nullptr)
+		return;
+	delete (Reader*)pContext->opaque;
+	av_free(pContext->buffer);		// may have been replaced by the demuxer, so it's taken from the context
+	av_free(pContext);
+}
+
+bool MappedFile::isLocalFile(const std::string& strFileName)
+{
+	// urls like http:// or rtsp:// go through ffmpeg's protocols, windows drive letters are no scheme
+	size_t iScheme = strFileName.find("://");
+	return iScheme == std::string::npos || strFileName.compare(0, iScheme, "file") == 0;
+}
+
+// the file descriptor is used on posix, the name on windows
+bool MappedFile::isOnLocalDisk(const std::string& strFileName, int iFile)
+{
+#ifdef _WIN32
+	char volume[MAX_PATH];
+	if(!GetVolumePathNameA(strFileName.c_str(), volume, MAX_PATH))
+		return false;
+	UINT iType = GetDriveTypeA(volume);		// unc paths are remote too
+	return iType == DRIVE_FIXED || iType == DRIVE_REMOVABLE || iType == DRIVE_CDROM || iType == DRIVE_RAMDISK;
+#elif defined(__linux__)
+	struct statfs status;
+	if(fstatfs(iFile, &status) != 0)
+		return false;
+	switch((unsigned long)status.f_type)
+	{
+		case 0x6969:		// nfs
+		case 0x517b:		// smb
+		case 0xff534d42:	// cifs
+		case 0xfe534d42:	// smb2
+		case 0x564c:		// ncp
+		case 0x65735546:	// fuse, sshfs and the like
+		case 0x73757245:	// coda
+		case 0x5346414f:	// afs
+			return false;
+		default:
+			return true;
+	}
+#else
+	struct statfs status;
+	return fstatfs(iFile, &status) == 0 && (status.f_flags & MNT_LOCAL) != 0;
+#endif
+}
+
+int MappedFile::read(void* pOpaque, unsigned char* pBuffer, int iSize)
+{
+	Reader* pReader = (Reader*)pOpaque;
+	MappedFile* pFile = pReader->m_pFile;
+	if(pReader->m_lPosition >= pFile->m_lSize)
+		return AVERROR_EOF;
+
+	if(pFile->m_iReadAheadWindow > 0 && pReader->m_lPosition + pFile->m_iReadAheadWindow / 2 > pReader->m_lPrefetched)
+	{
+		// ask for the next window while half of the previous one is still ahead
+		boost::int64_t lStart = (pReader->m_lPosition > pReader->m_lPrefetched) ? pReader->m_lPosition : pReader->m_lPrefetched;
+		boost::int64_t lEnd = pReader->m_lPosition + pFile->m_iReadAheadWindow;
+		pFile->prefetch(lStart, lEnd - lStart);
+		pReader->m_lPrefetched = lEnd;
+	}
+
+	if(iSize > pFile->m_lSize - pReader->m_lPosition)
+		iSize = (int)(pFile->m_lSize - pReader->m_lPosition);
+	memcpy(pBuffer, pFile->m_pData + pReader->m_lPosition, iSize);
+	pReader->m_lPosition += iSize;
+	return iSize;
+}
+
+boost::int64_t MappedFile::seek(void* pOpaque, boost::int64_t lOffset, int iWhence)
+{
+	Reader* pReader = (Reader*)pOpaque;
+	boost::int64_t lSize = pReader->m_pFile->m_lSize;
+	switch(iWhence & ~AVSEEK_FORCE)
+	{
+		case AVSEEK_SIZE:	return lSize;
+		case SEEK_SET:		break;
+		case SEEK_CUR:		lOffset += pReader->m_lPosition;	break;
+		case SEEK_END:		lOffset += lSize;	break;
+		default:			return -1;
+	}
+	if(lOffset < 0)
+		return -1;
+
+	// a jump elsewhere restarts the readahead from there
+	if(lOffset < pReader->m_lPosition || lOffset > pReader->m_lPrefetched)
+		pReader->m_lPrefetched = lOffset;
+	pReader->m_lPosition = lOffset;
+	return lOffset;
+}
+
+};
@@ -0,0 +1,76 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+*/
+
+#pragma once
+
+#include <string>
+#include <boost/cstdint.hpp>
+
+extern "C"
+{
+	#include "stdint.h"
+	#include "libavformat/avio.h"		// AVIOContext is an anonymous struct, so it can't be forward declared
+}
+
+namespace _2RealFFmpegWrapper
+{
+	// read only memory mapping of a local file, the demuxers read from it through AVIOContexts with their own position
+	// so there is one memcpy per read instead of a read() syscall, the hint tells the os how the pages are accessed,
+	// a readahead window additionally prefetches the pages in front of each reader (posix only)
+	// files on network shares aren't mapped, a network error while reading a page would be a SIGBUS or an access
+	// violation instead of a read error
+	// memory the application already holds can be attached instead and is read the same way
+	class MappedFile
+	{
+	public:
+		MappedFile();
+		~MappedFile();
+
+		bool					open(const std::string& strFileName, int iReadAheadHint, int iReadAheadWindow);	// window in bytes, 0 .. none
+		void					attach(const unsigned char* pData, boost::int64_t lSize);	// memory of the application, read in place and never freed
+		void					close();
+		bool					isOpen();
+		const unsigned char*	getData();
+		boost::int64_t			getSize();
+		void					prefetch(boost::int64_t lOffset, boost::int64_t lLength);
+		AVIOContext*			createIOContext();						// to be freed with freeIOContext, before the file is closed
+		static void				freeIOContext(AVIOContext* pContext);
+		static bool				isLocalFile(const std::string& strFileName);
+
+	private:
+		struct Reader;
+		static bool				isOnLocalDisk(const std::string& strFileName, int iFile);
+		static int				read(void* pOpaque, unsigned char* pBuffer, int iSize);
+		static boost::int64_t	seek(void* pOpaque, boost::int64_t lOffset, int iWhence);
+
+		const unsigned char*	m_pData;
+		boost::int64_t			m_lSize;
+		int						m_iReadAheadWindow;
+		void*					m_hFile;		// windows handles, unused on posix
+		void*					m_hMapping;
+		bool					m_bMapped;		// false for attached memory
+	};
+};
@@ -0,0 +1,190 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This wrapper uses FFmpeg, and is licensed and credited as follows:
+
+	 * copyright (c) 2001 Fabrice Bellard
+	 *
+	 * This  FFmpeg.
+	 *
+	 * FFmpeg is free software; you can redistribute it and/or
+	 * modify it under the terms of the GNU Lesser General Public
+	 * License as published by the Free Software Foundation; either
+	 * version 2.1 of the License, or (at your option) any later version.
+	 *
+	 * FFmpeg is distributed in the hope that it will be useful,
+	 * but WITHOUT ANY WARRANTY; without even the implied warranty of
+	 * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	 * Lesser General Public License for more details.
+	 *
+	 * You should have received a copy of the GNU Lesser General Public
+	 * License along with FFmpeg; if not, write to the Free Software
+	 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA	 
+*/
+
+#include "_2RealPacketPool.h"
+#include <cstring>
+
+// ffmpeg includes
+extern "C" {
+	#define __STDC_CONSTANT_MACROS
+	#include "stdint.h"
+	#include "libavcodec/avcodec.h"
+	#include "libavutil/mem.h"
+}
+
+namespace _2RealFFmpegWrapper
+{
+
+// the packet comes first, so the AVPacket pointers handed out can be cast back
+struct PooledPacket
+{
+	AVPacket		m_Packet;
+	uint8_t*		m_pBuffer;			// own payload buffer, grows to the largest copied payload
+	int				m_iBufferSize;
+};
+
+PacketPool::PacketPool(int iCapacity) : m_lShellAllocations(0), m_lPayloadAllocations(0)
+{
+	setCapacity(iCapacity);
+}
+
+PacketPool::~PacketPool()
+{
+	PooledPacket* pPacket = nullptr;
+	while(m_FreePackets.tryPop(pPacket))
+		freePacket(pPacket);
+}
+
+void PacketPool::setCapacity(int iCapacity)
+{
+	// the queue drops its items when resized, so they are taken out first
+	std::vector<PooledPacket*> packets;
+	PooledPacket* pPacket = nullptr;
+	while(m_FreePackets.tryPop(pPacket))
+		packets.push_back(pPacket);
+	m_FreePackets.setCapacity(iCapacity);
+	for(size_t i=0; i<packets.size(); i++)
+	{
+		if(!m_FreePackets.tryPush(packets[i]))
+			freePacket(packets[i]);
+	}
+	// shells are cheap, so all of them are allocated up front
+	while(m_FreePackets.size() < iCapacity)
+	{
+		pPacket = allocatePacket();
+		if(pPacket == nullptr || !m_FreePackets.tryPush(pPacket))
+		{
+			if(pPacket != nullptr)
+				freePacket(pPacket);
+			break;
+		}
+	}
+}
+
+PooledPacket* PacketPool::allocatePacket()
+{
+	PooledPacket* pPacket = new PooledPacket();
+	av_init_packet(&pPacket->m_Packet);
+	pPacket->m_Packet.data = nullptr;
+	pPacket->m_Packet.size = 0;
+	pPacket->m_pBuffer = nullptr;
+	pPacket->m_iBufferSize = 0;
+	m_lShellAllocations.fetch_add(1, boost::memory_order_relaxed);
+	return pPacket;
+}
+
+void PacketPool::freePacket(PooledPacket* pPacket)
+{
+	av_free(pPacket->m_pBuffer);
+	delete pPacket;
+}
+
+AVPacket* PacketPool::acquire()
+{
+	PooledPacket* pPacket = nullptr;
+	if(!m_FreePackets.tryPop(pPacket))
+		pPacket = allocatePacket();		// more packets out than the queues hold, e.g. while seeking
+	av_init_packet(&pPacket->m_Packet);
+	pPacket->m_Packet.data = nullptr;
+	pPacket->m_Packet.size = 0;
+	return &pPacket->m_Packet;
+}
+
+bool PacketPool::own(AVPacket* pAVPacket)
+{
+	if(pAVPacket->data == nullptr)
+		return true;
+	if(pAVPacket->destruct != nullptr)
+	{
+		m_lPayloadAllocations.fetch_add(1, boost::memory_order_relaxed);		// the demuxer allocated it for this packet
+		return true;
+	}
+	// side data is rare, av_dup_packet takes care of it
+	if(pAVPacket->side_data_elems > 0)
+	{
+		m_lPayloadAllocations.fetch_add(1, boost::memory_order_relaxed);
+		return av_dup_packet(pAVPacket) >= 0;
+	}
+
+	PooledPacket* pPacket = (PooledPacket*)pAVPacket;
+	int iSize = pAVPacket->size + FF_INPUT_BUFFER_PADDING_SIZE;
+	if(pPacket->m_iBufferSize < iSize)
+	{
+		av_free(pPacket->m_pBuffer);
+		pPacket->m_iBufferSize = 0;
+		pPacket->m_pBuffer = (uint8_t*)av_malloc(iSize);
+		if(pPacket->m_pBuffer == nullptr)
+			return false;
+		pPacket->m_iBufferSize = iSize;
+		m_lPayloadAllocations.fetch_add(1, boost::memory_order_relaxed);
+	}
+	memcpy(pPacket->m_pBuffer, pAVPacket->data, pAVPacket->size);
+	memset(pPacket->m_pBuffer + pAVPacket->size, 0, FF_INPUT_BUFFER_PADDING_SIZE);		// the decoders read a bit past the end
+	pAVPacket->data = pPacket->m_pBuffer;
+	return true;
+}
+
+void PacketPool::release(AVPacket* pAVPacket)
+{
+	if(pAVPacket == nullptr)
+		return;
+	av_free_packet(pAVPacket);		// just resets packets pointing to the own buffer, as they come without destructor
+	PooledPacket* pPacket = (PooledPacket*)pAVPacket;
+	if(!m_FreePackets.tryPush(pPacket))
+		freePacket(pPacket);
+}
+
+long PacketPool::getShellAllocationCount()
+{
+	return m_lShellAllocations.load(boost::memory_order_relaxed);
+}
+
+long PacketPool::getPayloadAllocationCount()
+{
+	return m_lPayloadAllocations.load(boost::memory_order_relaxed);
+}
+
+};
@@ -0,0 +1,62 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+*/
+
+#pragma once
+
+#include "_2RealBoundedQueue.h"
+#include <boost/atomic.hpp>
+
+struct AVPacket;
+
+namespace _2RealFFmpegWrapper
+{
+	struct PooledPacket;
+
+	// AVPacket shells of one player, recycled between the demuxer and the decoder threads so steady state demuxing doesn't
+	// allocate them per packet. payloads still referenced from the demuxer's buffers are copied into a buffer kept with the
+	// shell instead of av_dup_packet allocating a new one, payloads allocated by the demuxer are freed on release as before
+	class PacketPool
+	{
+	public:
+		PacketPool(int iCapacity);
+		~PacketPool();					// all packets have to be released before
+
+		void			setCapacity(int iCapacity);		// shells kept for reuse, just call it while no packets are out
+		AVPacket*		acquire();						// an initialized empty packet, allocates only when none is free
+		bool			own(AVPacket* pPacket);			// makes sure the payload outlives the next av_read_frame
+		void			release(AVPacket* pPacket);		// frees the payload if ffmpeg allocated it and recycles the shell
+		long			getShellAllocationCount();		// shells allocated since the pool was created
+		long			getPayloadAllocationCount();	// payloads allocated by the demuxer, by av_dup_packet or as a larger own buffer
+
+	private:
+		PooledPacket*	allocatePacket();
+		void			freePacket(PooledPacket* pPacket);
+
+		BoundedQueue<PooledPacket*>	m_FreePackets;
+		boost::atomic<long>			m_lShellAllocations;
+		boost::atomic<long>			m_lPayloadAllocations;
+	};
+};
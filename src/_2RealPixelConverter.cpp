@@ -0,0 +1,429 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This wrapper uses FFmpeg, and is licensed and credited as follows:
+
+	 * copyright (c) 2001 Fabrice Bellard
+	 *
+	 * This  FFmpeg.
+	 *
+	 * FFmpeg is free software; you can redistribute it and/or
+	 * modify it under the terms of the GNU Lesser General Public
+	 * License as published by the Free Software Foundation; either
+	 * version 2.1 of the License, or (at your option) any later version.
+	 *
+	 * FFmpeg is distributed in the hope that it will be useful,
+	 * but WITHOUT ANY WARRANTY; without even the implied warranty of
+	 * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	 * Lesser General Public License for more details.
+	 *
+	 * You should have received a copy of the GNU Lesser General Public
+	 * License along with FFmpeg; if not, write to the Free Software
+	 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA	 
+*/
+
+#include "_2RealPixelConverter.h"
+
+// ffmpeg includes
+extern "C" {
+	#define __STDC_CONSTANT_MACROS
+	#include "stdint.h"
+	#include "libavutil/avutil.h"
+	#include "libavutil/cpu.h"
+	#include "libavutil/pixfmt.h"
+}
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+	#define HAS_SSE2_KERNELS
+	#include <emmintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define SSE2_TARGET
+		#if _MSC_VER >= 1800	// avx2 intrinsics came with vs 2013
+			#define HAS_AVX2_KERNELS
+			#include <immintrin.h>
+			#define AVX2_TARGET
+		#endif
+	#elif defined(__GNUC__)
+		#define SSE2_TARGET __attribute__((target("sse2")))
+		#define HAS_AVX2_KERNELS
+		#include <immintrin.h>
+		#define AVX2_TARGET __attribute__((target("avx2")))
+	#else
+		#undef HAS_SSE2_KERNELS
+	#endif
+#endif
+
+namespace _2RealFFmpegWrapper
+{
+
+enum {eSourceYUV420P, eSourceNV12, eSourceRGB24};
+
+// bt.601 limited range in 6 bit fixed point, luma is scaled by 74.5 so white ends up at 255, all kernels use the same
+// integer math so they put out the same bytes
+enum {eCoefY = 74, eCoefRV = 102, eCoefGU = 25, eCoefGV = 52, eCoefBU = 129};
+
+static inline unsigned char clampToByte(int iValue)
+{
+	return (unsigned char)((iValue < 0) ? 0 : ((iValue > 255) ? 255 : iValue));
+}
+
+// chroma of nv12 is interleaved, so u and v are two bytes apart
+template <bool bRgba, bool bNV12>
+static void convertYuvRowScalar(const unsigned char* pY, const unsigned char* pU, const unsigned char* pV, unsigned char* pDst, int iFirst, int iWidth)
+{
+	const int iStep = bNV12 ? 2 : 1;
+	for(int x=iFirst; x<iWidth; x++)
+	{
+		int iLuma = pY[x] - 16;
+		int iY = iLuma * eCoefY + (iLuma >> 1) + 32;
+		int iU = pU[(x >> 1) * iStep] - 128;
+		int iV = pV[(x >> 1) * iStep] - 128;
+		unsigned char r = clampToByte((iY + eCoefRV * iV) >> 6);
+		unsigned char g = clampToByte((iY - eCoefGU * iU - eCoefGV * iV) >> 6);
+		unsigned char b = clampToByte((iY + eCoefBU * iU) >> 6);
+		pDst[x * 4] = bRgba ? r : b;
+		pDst[x * 4 + 1] = g;
+		pDst[x * 4 + 2] = bRgba ? b : r;
+		pDst[x * 4 + 3] = 255;
+	}
+}
+
+template <bool bRgba>
+static void convertRgbRowScalar(const unsigned char* pSrc, unsigned char* pDst, int iFirst, int iWidth)
+{
+	for(int x=iFirst; x<iWidth; x++)
+	{
+		pDst[x * 4] = bRgba ? pSrc[x * 3] : pSrc[x * 3 + 2];
+		pDst[x * 4 + 1] = pSrc[x * 3 + 1];
+		pDst[x * 4 + 2] = bRgba ? pSrc[x * 3 + 2] : pSrc[x * 3];
+		pDst[x * 4 + 3] = 255;
+	}
+}
+
+#ifdef HAS_SSE2_KERNELS
+
+// 16 pixels per step, returns the number of pixels done, the rest is left to the scalar kernel
+template <bool bRgba, bool bNV12>
+SSE2_TARGET static int convertYuvRowSse2(const unsigned char* pY, const unsigned char* pU, const unsigned char* pV, unsigned char* pDst, int iWidth)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i alpha = _mm_set1_epi8((char)255);
+	const __m128i lumaOffset = _mm_set1_epi16(16);
+	const __m128i chromaOffset = _mm_set1_epi16(128);
+	const __m128i round = _mm_set1_epi16(32);
+	const __m128i coefY = _mm_set1_epi16(eCoefY);
+	const __m128i coefRV = _mm_set1_epi16(eCoefRV);
+	const __m128i coefGU = _mm_set1_epi16(eCoefGU);
+	const __m128i coefGV = _mm_set1_epi16(eCoefGV);
+	const __m128i coefBU = _mm_set1_epi16(eCoefBU);
+	const __m128i lowBytes = _mm_set1_epi16(0x00ff);
+
+	int x = 0;
+	for(; x + 16 <= iWidth; x += 16)
+	{
+		__m128i y8 = _mm_loadu_si128((const __m128i*)(pY + x));
+		__m128i u16, v16;
+		if(bNV12)
+		{
+			__m128i uv = _mm_loadu_si128((const __m128i*)(pU + x));
+			u16 = _mm_and_si128(uv, lowBytes);
+			v16 = _mm_srli_epi16(uv, 8);
+		}
+		else
+		{
+			u16 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(pU + x / 2)), zero);
+			v16 = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(pV + x / 2)), zero);
+		}
+		u16 = _mm_sub_epi16(u16, chromaOffset);
+		v16 = _mm_sub_epi16(v16, chromaOffset);
+
+		// every chroma sample covers two pixels
+		__m128i channels[2][3];
+		for(int iHalf=0; iHalf<2; iHalf++)
+		{
+			__m128i y = _mm_sub_epi16((iHalf == 0) ? _mm_unpacklo_epi8(y8, zero) : _mm_unpackhi_epi8(y8, zero), lumaOffset);
+			__m128i u = (iHalf == 0) ? _mm_unpacklo_epi16(u16, u16) : _mm_unpackhi_epi16(u16, u16);
+			__m128i v = (iHalf == 0) ? _mm_unpacklo_epi16(v16, v16) : _mm_unpackhi_epi16(v16, v16);
+			y = _mm_adds_epi16(_mm_add_epi16(_mm_mullo_epi16(y, coefY), _mm_srai_epi16(y, 1)), round);
+			channels[iHalf][0] = _mm_srai_epi16(_mm_adds_epi16(y, _mm_mullo_epi16(v, coefRV)), 6);
+			channels[iHalf][1] = _mm_srai_epi16(_mm_subs_epi16(_mm_subs_epi16(y, _mm_mullo_epi16(u, coefGU)), _mm_mullo_epi16(v, coefGV)), 6);
+			channels[iHalf][2] = _mm_srai_epi16(_mm_adds_epi16(y, _mm_mullo_epi16(u, coefBU)), 6);
+		}
+		__m128i r = _mm_packus_epi16(channels[0][0], channels[1][0]);
+		__m128i g = _mm_packus_epi16(channels[0][1], channels[1][1]);
+		__m128i b = _mm_packus_epi16(channels[0][2], channels[1][2]);
+		__m128i first = bRgba ? r : b;
+		__m128i third = bRgba ? b : r;
+
+		__m128i lo01 = _mm_unpacklo_epi8(first, g);
+		__m128i hi01 = _mm_unpackhi_epi8(first, g);
+		__m128i lo23 = _mm_unpacklo_epi8(third, alpha);
+		__m128i hi23 = _mm_unpackhi_epi8(third, alpha);
+		__m128i* pOut = (__m128i*)(pDst + x * 4);
+		_mm_storeu_si128(pOut, _mm_unpacklo_epi16(lo01, lo23));
+		_mm_storeu_si128(pOut + 1, _mm_unpackhi_epi16(lo01, lo23));
+		_mm_storeu_si128(pOut + 2, _mm_unpacklo_epi16(hi01, hi23));
+		_mm_storeu_si128(pOut + 3, _mm_unpackhi_epi16(hi01, hi23));
+	}
+	return x;
+}
+
+#endif
+
+#ifdef HAS_AVX2_KERNELS
+
+// 32 pixels per step, 256 bit unpacks work per 128 bit lane, the permutes put the pixels back in order
+template <bool bRgba, bool bNV12>
+AVX2_TARGET static int convertYuvRowAvx2(const unsigned char* pY, const unsigned char* pU, const unsigned char* pV, unsigned char* pDst, int iWidth)
+{
+	const __m256i alpha = _mm256_set1_epi8((char)255);
+	const __m256i lumaOffset = _mm256_set1_epi16(16);
+	const __m256i chromaOffset = _mm256_set1_epi16(128);
+	const __m256i round = _mm256_set1_epi16(32);
+	const __m256i coefY = _mm256_set1_epi16(eCoefY);
+	const __m256i coefRV = _mm256_set1_epi16(eCoefRV);
+	const __m256i coefGU = _mm256_set1_epi16(eCoefGU);
+	const __m256i coefGV = _mm256_set1_epi16(eCoefGV);
+	const __m256i coefBU = _mm256_set1_epi16(eCoefBU);
+	const __m256i lowBytes = _mm256_set1_epi16(0x00ff);
+
+	int x = 0;
+	for(; x + 32 <= iWidth; x += 32)
+	{
+		// chroma of pixels 0..31 as 16 bit, lane 0 holds samples 0..7, lane 1 samples 8..15
+		__m256i u16, v16;
+		if(bNV12)
+		{
+			__m256i uv = _mm256_loadu_si256((const __m256i*)(pU + x));
+			u16 = _mm256_and_si256(uv, lowBytes);
+			v16 = _mm256_srli_epi16(uv, 8);
+		}
+		else
+		{
+			u16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(pU + x / 2)));
+			v16 = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(pV + x / 2)));
+		}
+		u16 = _mm256_sub_epi16(u16, chromaOffset);
+		v16 = _mm256_sub_epi16(v16, chromaOffset);
+		__m256i uLo = _mm256_unpacklo_epi16(u16, u16);
+		__m256i uHi = _mm256_unpackhi_epi16(u16, u16);
+		__m256i vLo = _mm256_unpacklo_epi16(v16, v16);
+		__m256i vHi = _mm256_unpackhi_epi16(v16, v16);
+
+		__m256i channels[2][3];
+		for(int iHalf=0; iHalf<2; iHalf++)
+		{
+			// half 0 are pixels 0..15, half 1 pixels 16..31
+			__m256i y = _mm256_sub_epi16(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(pY + x + iHalf * 16))), lumaOffset);
+			__m256i u = (iHalf == 0) ? _mm256_permute2x128_si256(uLo, uHi, 0x20) : _mm256_permute2x128_si256(uLo, uHi, 0x31);
+			__m256i v = (iHalf == 0) ? _mm256_permute2x128_si256(vLo, vHi, 0x20) : _mm256_permute2x128_si256(vLo, vHi, 0x31);
+			y = _mm256_adds_epi16(_mm256_add_epi16(_mm256_mullo_epi16(y, coefY), _mm256_srai_epi16(y, 1)), round);
+			channels[iHalf][0] = _mm256_srai_epi16(_mm256_adds_epi16(y, _mm256_mullo_epi16(v, coefRV)), 6);
+			channels[iHalf][1] = _mm256_srai_epi16(_mm256_subs_epi16(_mm256_subs_epi16(y, _mm256_mullo_epi16(u, coefGU)), _mm256_mullo_epi16(v, coefGV)), 6);
+			channels[iHalf][2] = _mm256_srai_epi16(_mm256_adds_epi16(y, _mm256_mullo_epi16(u, coefBU)), 6);
+		}
+		// lane 0 holds pixels 0..7 and 16..23, lane 1 pixels 8..15 and 24..31
+		__m256i r = _mm256_packus_epi16(channels[0][0], channels[1][0]);
+		__m256i g = _mm256_packus_epi16(channels[0][1], channels[1][1]);
+		__m256i b = _mm256_packus_epi16(channels[0][2], channels[1][2]);
+		__m256i first = bRgba ? r : b;
+		__m256i third = bRgba ? b : r;
+
+		__m256i lo01 = _mm256_unpacklo_epi8(first, g);
+		__m256i hi01 = _mm256_unpackhi_epi8(first, g);
+		__m256i lo23 = _mm256_unpacklo_epi8(third, alpha);
+		__m256i hi23 = _mm256_unpackhi_epi8(third, alpha);
+		__m256i p0 = _mm256_unpacklo_epi16(lo01, lo23);		// pixels 0..3, 8..11
+		__m256i p1 = _mm256_unpackhi_epi16(lo01, lo23);		// 4..7, 12..15
+		__m256i p2 = _mm256_unpacklo_epi16(hi01, hi23);		// 16..19, 24..27
+		__m256i p3 = _mm256_unpackhi_epi16(hi01, hi23);		// 20..23, 28..31
+		__m256i* pOut = (__m256i*)(pDst + x * 4);
+		_mm256_storeu_si256(pOut, _mm256_permute2x128_si256(p0, p1, 0x20));
+		_mm256_storeu_si256(pOut + 1, _mm256_permute2x128_si256(p0, p1, 0x31));
+		_mm256_storeu_si256(pOut + 2, _mm256_permute2x128_si256(p2, p3, 0x20));
+		_mm256_storeu_si256(pOut + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+	}
+	return x;
+}
+
+// sse2 has no byte shuffle, every avx2 cpu has the ssse3 one, 4 pixels per shuffle, 8 per step
+template <bool bRgba>
+AVX2_TARGET static int convertRgbRowAvx2(const unsigned char* pSrc, unsigned char* pDst, int iWidth)
+{
+	const __m128i shuffle = bRgba ?
+		_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1) :
+		_mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1);
+	const __m256i shuffle2 = _mm256_broadcastsi128_si256(shuffle);
+	const __m256i alpha = _mm256_set1_epi32((int)0xff000000);
+
+	// each load reads 16 bytes for 12 used ones, so the last pixels of the row are left to the scalar kernel
+	int x = 0;
+	for(; x + 8 + 2 <= iWidth; x += 8)
+	{
+		__m256i rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(pSrc + x * 3))), _mm_loadu_si128((const __m128i*)(pSrc + x * 3 + 12)), 1);
+		_mm256_storeu_si256((__m256i*)(pDst + x * 4), _mm256_or_si256(_mm256_shuffle_epi8(rgb, shuffle2), alpha));
+	}
+	return x;
+}
+
+#endif
+
+enum {eKernelScalarId = PixelConverter::eKernelScalar, eKernelSse2Id = PixelConverter::eKernelSse2, eKernelAvx2Id = PixelConverter::eKernelAvx2};
+
+template <bool bRgba, bool bNV12, int iKernel>
+static inline void convertYuvRow(const unsigned char* pY, const unsigned char* pU, const unsigned char* pV, unsigned char* pDst, int iWidth)
+{
+	int iDone = 0;
+#ifdef HAS_AVX2_KERNELS
+	if(iKernel == eKernelAvx2Id)
+		iDone = convertYuvRowAvx2<bRgba, bNV12>(pY, pU, pV, pDst, iWidth);
+#endif
+#ifdef HAS_SSE2_KERNELS
+	if(iKernel == eKernelSse2Id)
+		iDone = convertYuvRowSse2<bRgba, bNV12>(pY, pU, pV, pDst, iWidth);
+#endif
+	convertYuvRowScalar<bRgba, bNV12>(pY, pU, pV, pDst, iDone, iWidth);
+}
+
+template <bool bRgba, int iKernel>
+static inline void convertRgbRow(const unsigned char* pSrc, unsigned char* pDst, int iWidth)
+{
+	int iDone = 0;
+#ifdef HAS_AVX2_KERNELS
+	if(iKernel == eKernelAvx2Id)
+		iDone = convertRgbRowAvx2<bRgba>(pSrc, pDst, iWidth);
+#endif
+	convertRgbRowScalar<bRgba>(pSrc, pDst, iDone, iWidth);
+}
+
+template <int iSource, bool bRgba, int iKernel>
+static void convertFrame(const unsigned char* const* pSrcPlanes, const int* pSrcLinesizes, unsigned char* pDst, int iDstLinesize, int iWidth, int iHeight)
+{
+	for(int y=0; y<iHeight; y++)
+	{
+		unsigned char* pRow = pDst + y * iDstLinesize;
+		if(iSource == eSourceRGB24)
+			convertRgbRow<bRgba, iKernel>(pSrcPlanes[0] + y * pSrcLinesizes[0], pRow, iWidth);
+		else
+		{
+			const unsigned char* pY = pSrcPlanes[0] + y * pSrcLinesizes[0];
+			const unsigned char* pU = pSrcPlanes[1] + (y >> 1) * pSrcLinesizes[1];
+			const unsigned char* pV = (iSource == eSourceNV12) ? pU + 1 : pSrcPlanes[2] + (y >> 1) * pSrcLinesizes[2];
+			convertYuvRow<bRgba, iSource == eSourceNV12, iKernel>(pY, pU, pV, pRow, iWidth);
+		}
+	}
+}
+
+// all kernels of one isa, indexed by source and then bgra, rgba
+template <int iKernel>
+static PixelConverter::Function getKernel(int iSource, bool bRgba)
+{
+	static const PixelConverter::Function s_Functions[3][2] =
+	{
+		{ convertFrame<eSourceYUV420P, false, iKernel>, convertFrame<eSourceYUV420P, true, iKernel> },
+		{ convertFrame<eSourceNV12, false, iKernel>, convertFrame<eSourceNV12, true, iKernel> },
+		{ convertFrame<eSourceRGB24, false, iKernel>, convertFrame<eSourceRGB24, true, iKernel> }
+	};
+	return s_Functions[iSource][bRgba ? 1 : 0];
+}
+
+static int detectBestKernel()
+{
+#ifdef HAS_SSE2_KERNELS
+	int iFlags = av_get_cpu_flags();
+	if(!(iFlags & AV_CPU_FLAG_SSE2))
+		return PixelConverter::eKernelScalar;
+	#ifdef HAS_AVX2_KERNELS
+		// the avx flag includes the os saving the ymm registers, avx2 itself is bit 5 of ebx of leaf 7
+		if(iFlags & AV_CPU_FLAG_AVX)
+		{
+		#if defined(_MSC_VER)
+			int info[4];
+			__cpuidex(info, 7, 0);
+			if(info[1] & (1 << 5))
+				return PixelConverter::eKernelAvx2;
+		#else
+			if(__builtin_cpu_supports("avx2"))
+				return PixelConverter::eKernelAvx2;
+		#endif
+		}
+	#endif
+	return PixelConverter::eKernelSse2;
+#else
+	return PixelConverter::eKernelScalar;
+#endif
+}
+
+int PixelConverter::getBestKernel()
+{
+	static const int s_iBestKernel = detectBestKernel();
+	return s_iBestKernel;
+}
+
+const char* PixelConverter::getKernelName(int iKernel)
+{
+	switch(iKernel)
+	{
+		case eKernelScalar:	return "scalar";
+		case eKernelSse2:	return "sse2";
+		case eKernelAvx2:	return "avx2";
+		default:			return getKernelName(getBestKernel());
+	}
+}
+
+PixelConverter::Function PixelConverter::find(int iSrcFormat, int iDstFormat, int iKernel)
+{
+	int iSource;
+	switch(iSrcFormat)
+	{
+		case PIX_FMT_YUV420P:	iSource = eSourceYUV420P;	break;
+		case PIX_FMT_NV12:		iSource = eSourceNV12;		break;
+		case PIX_FMT_RGB24:		iSource = eSourceRGB24;		break;
+		default:				return nullptr;
+	}
+	if(iDstFormat != PIX_FMT_BGRA && iDstFormat != PIX_FMT_RGBA)
+		return nullptr;
+	bool bRgba = (iDstFormat == PIX_FMT_RGBA);
+
+	if(iKernel == eKernelBest)
+		iKernel = getBestKernel();
+	else if(iKernel > getBestKernel())
+		return nullptr;		// the cpu can't run it
+
+	switch(iKernel)
+	{
+#ifdef HAS_AVX2_KERNELS
+		case eKernelAvx2:	return getKernel<eKernelAvx2Id>(iSource, bRgba);
+#endif
+#ifdef HAS_SSE2_KERNELS
+		case eKernelSse2:	return getKernel<eKernelSse2Id>(iSource, bRgba);
+#endif
+		case eKernelScalar:	return getKernel<eKernelScalarId>(iSource, bRgba);
+		default:			return nullptr;
+	}
+}
+
+};
@@ -0,0 +1,45 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+*/
+
+#pragma once
+
+namespace _2RealFFmpegWrapper
+{
+	// converts yuv420p, nv12 and rgb24 pictures into bgra or rgba of the same size without swscale, the kernels are
+	// specialized at compile time per source and output format and picked at runtime by what the cpu supports
+	// yuv is taken as bt.601 limited range like swscale does by default, full range (yuvj) sources still go through swscale
+	class PixelConverter
+	{
+	public:
+		typedef void (*Function)(const unsigned char* const* pSrcPlanes, const int* pSrcLinesizes, unsigned char* pDst, int iDstLinesize, int iWidth, int iHeight);
+
+		enum {eKernelScalar, eKernelSse2, eKernelAvx2, eKernelBest};
+
+		static Function		find(int iSrcFormat, int iDstFormat, int iKernel = eKernelBest);	// nullptr if the pair or kernel isn't supported
+		static int			getBestKernel();
+		static const char*	getKernelName(int iKernel);
+	};
+};
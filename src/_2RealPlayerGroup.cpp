@@ -0,0 +1,203 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This wrapper uses FFmpeg, and is licensed and credited as follows:
+
+	 * copyright (c) 2001 Fabrice Bellard
+	 *
+	 * This  FFmpeg.
+	 *
+	 * FFmpeg is free software; you can redistribute it and/or
+	 * modify it under the terms of the GNU Lesser General Public
+	 * License as published by the Free Software Foundation; either
+	 * version 2.1 of the License, or (at your option) any later version.
+	 *
+	 * FFmpeg is distributed in the hope that it will be useful,
+	 * but WITHOUT ANY WARRANTY; without even the implied warranty of
+	 * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	 * Lesser General Public License for more details.
+	 *
+	 * You should have received a copy of the GNU Lesser General Public
+	 * License along with FFmpeg; if not, write to the Free Software
+	 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA	 
+*/
+
+#include "_2RealPlayerGroup.h"
+#include "_2RealFFmpegWrapper.h"
+#include <algorithm>
+
+namespace _2RealFFmpegWrapper
+{
+
+struct PlayerGroup::Waiter
+{
+	FFmpegWrapper*				m_pPlayer;
+	boost::condition_variable	m_Condition;
+	bool						m_bGranted;
+};
+
+PlayerGroup::PlayerGroup(int iSlots) : m_iSlots(1), m_iBusySlots(0)
+{
+	setSlotCount(iSlots);
+}
+
+PlayerGroup::~PlayerGroup()
+{
+	std::vector<FFmpegWrapper*> players;
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		players.swap(m_Players);
+	}
+	for(size_t i=0; i<players.size(); i++)
+	{
+		players[i]->stopPlayerThreads();
+		players[i]->m_pGroup = nullptr;
+	}
+}
+
+bool PlayerGroup::add(FFmpegWrapper* pPlayer)
+{
+	if(pPlayer == nullptr || pPlayer->m_bIsThreadRunning || pPlayer->m_pGroup != nullptr)
+		return false;
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_Players.push_back(pPlayer);
+	pPlayer->m_pGroup = this;
+	return true;
+}
+
+bool PlayerGroup::remove(FFmpegWrapper* pPlayer)
+{
+	if(pPlayer == nullptr || pPlayer->m_bIsThreadRunning || pPlayer->m_pGroup != this)
+		return false;
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_Players.erase(std::remove(m_Players.begin(), m_Players.end(), pPlayer), m_Players.end());
+	pPlayer->m_pGroup = nullptr;
+	return true;
+}
+
+void PlayerGroup::update()
+{
+	std::vector<FFmpegWrapper*> players;
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		players = m_Players;
+	}
+	for(size_t i=0; i<players.size(); i++)
+		players[i]->update();
+}
+
+void PlayerGroup::setSlotCount(int iSlots)
+{
+	if(iSlots <= 0)
+		iSlots = boost::thread::hardware_concurrency();
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_iSlots = (iSlots < 1) ? 1 : iSlots;
+	dispatch();
+}
+
+int PlayerGroup::getSlotCount()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return m_iSlots;
+}
+
+int PlayerGroup::getBusySlots()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return m_iBusySlots;
+}
+
+int PlayerGroup::getPlayerCount()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return (int)m_Players.size();
+}
+
+bool PlayerGroup::acquireSlot(FFmpegWrapper* pPlayer)
+{
+	Waiter waiter;
+	waiter.m_pPlayer = pPlayer;
+	waiter.m_bGranted = false;
+
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_Waiting.push_back(&waiter);
+	dispatch();
+	while(!waiter.m_bGranted)
+	{
+		if(!pPlayer->m_bIsThreadRunning)
+		{
+			m_Waiting.erase(std::remove(m_Waiting.begin(), m_Waiting.end(), &waiter), m_Waiting.end());
+			return false;
+		}
+		waiter.m_Condition.wait(scopedLock);
+	}
+	return true;
+}
+
+void PlayerGroup::releaseSlot()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_iBusySlots--;
+	dispatch();
+}
+
+void PlayerGroup::wake()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	for(size_t i=0; i<m_Waiting.size(); i++)
+		m_Waiting[i]->m_Condition.notify_one();		// lets stopped players leave
+	dispatch();
+}
+
+// earliest deadline first, the deadlines change with every presented frame, so they are taken right when a slot is free
+void PlayerGroup::dispatch()
+{
+	while(m_iBusySlots < m_iSlots)
+	{
+		int iBest = -1;
+		double dBestDeadline = 0;
+		for(size_t i=0; i<m_Waiting.size(); i++)
+		{
+			if(!m_Waiting[i]->m_pPlayer->isDecodeActive())
+				continue;
+			double dDeadline = m_Waiting[i]->m_pPlayer->getDecodeDeadline();
+			if(iBest < 0 || dDeadline < dBestDeadline)
+			{
+				iBest = (int)i;
+				dBestDeadline = dDeadline;
+			}
+		}
+		if(iBest < 0)
+			return;
+
+		Waiter* pWaiter = m_Waiting[iBest];
+		m_Waiting.erase(m_Waiting.begin() + iBest);
+		pWaiter->m_bGranted = true;
+		m_iBusySlots++;
+		pWaiter->m_Condition.notify_one();
+	}
+}
+
+};
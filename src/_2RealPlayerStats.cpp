@@ -0,0 +1,107 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This wrapper uses FFmpeg, and is licensed and credited as follows:
+
+	 * copyright (c) 2001 Fabrice Bellard
+	 *
+	 * This  FFmpeg.
+	 *
+	 * FFmpeg is free software; you can redistribute it and/or
+	 * modify it under the terms of the GNU Lesser General Public
+	 * License as published by the Free Software Foundation; either
+	 * version 2.1 of the License, or (at your option) any later version.
+	 *
+	 * FFmpeg is distributed in the hope that it will be useful,
+	 * but WITHOUT ANY WARRANTY; without even the implied warranty of
+	 * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	 * Lesser General Public License for more details.
+	 *
+	 * You should have received a copy of the GNU Lesser General Public
+	 * License along with FFmpeg; if not, write to the Free Software
+	 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA	 
+*/
+
+#include "_2RealPlayerStats.h"
+
+namespace _2RealFFmpegWrapper
+{
+
+TimingCounter::TimingCounter()
+{
+	reset();
+}
+
+void TimingCounter::add(const boost::chrono::steady_clock::time_point& start)
+{
+	boost::int64_t lTime = boost::chrono::duration_cast<boost::chrono::nanoseconds>(boost::chrono::steady_clock::now() - start).count();
+
+	// one writer, so maximum and average need no compare exchange, relaxed as the values don't guard any other data
+	m_lCount.fetch_add(1, boost::memory_order_relaxed);
+	m_lTotal.fetch_add(lTime, boost::memory_order_relaxed);
+	if(lTime > m_lMax.load(boost::memory_order_relaxed))
+		m_lMax.store(lTime, boost::memory_order_relaxed);
+	boost::int64_t lRecent = m_lRecent.load(boost::memory_order_relaxed);
+	m_lRecent.store((lRecent == 0) ? lTime : lRecent + (lTime - lRecent) / 16, boost::memory_order_relaxed);
+}
+
+void TimingCounter::reset()
+{
+	m_lCount.store(0, boost::memory_order_relaxed);
+	m_lTotal.store(0, boost::memory_order_relaxed);
+	m_lMax.store(0, boost::memory_order_relaxed);
+	m_lRecent.store(0, boost::memory_order_relaxed);
+}
+
+TimingStats TimingCounter::get()
+{
+	TimingStats stats;
+	stats.m_lCount = m_lCount.load(boost::memory_order_relaxed);
+	stats.m_dTotalInMs = m_lTotal.load(boost::memory_order_relaxed) / 1000000.0;
+	stats.m_dMaxInMs = m_lMax.load(boost::memory_order_relaxed) / 1000000.0;
+	stats.m_dRecentInMs = m_lRecent.load(boost::memory_order_relaxed) / 1000000.0;
+	return stats;
+}
+
+PlayerCounters::PlayerCounters()
+{
+	reset();
+}
+
+void PlayerCounters::reset()
+{
+	m_lPacketsDemuxed.store(0, boost::memory_order_relaxed);
+	m_lBytesDemuxed.store(0, boost::memory_order_relaxed);
+	m_lFramesDecoded.store(0, boost::memory_order_relaxed);
+	m_lFramesDropped.store(0, boost::memory_order_relaxed);
+	m_lFramesPresented.store(0, boost::memory_order_relaxed);
+	m_Demux.reset();
+	m_VideoDecode.reset();
+	m_AudioDecode.reset();
+	m_Scale.reset();
+	m_Copy.reset();
+}
+
+};
@@ -0,0 +1,70 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+*/
+
+#pragma once
+
+#include "_2RealFFmpegWrapper.h"
+#include <boost/atomic.hpp>
+#include <boost/chrono.hpp>
+
+namespace _2RealFFmpegWrapper
+{
+	// call count, total, maximum and moving average of one kind of work, in nanoseconds
+	// there is one writer per counter, which never waits, getStats may read from any thread at any time
+	class TimingCounter
+	{
+	public:
+		TimingCounter();
+
+		void			add(const boost::chrono::steady_clock::time_point& start);	// the work took from start until now
+		void			reset();
+		TimingStats		get();
+
+	private:
+		boost::atomic<long>				m_lCount;
+		boost::atomic<boost::int64_t>	m_lTotal;
+		boost::atomic<boost::int64_t>	m_lMax;
+		boost::atomic<boost::int64_t>	m_lRecent;		// exponentially weighted, 1/16 per call
+	};
+
+	// counters of one player, written by its demuxer, decoder and caller threads
+	struct PlayerCounters
+	{
+		PlayerCounters();
+		void			reset();
+
+		boost::atomic<long>				m_lPacketsDemuxed;
+		boost::atomic<boost::int64_t>	m_lBytesDemuxed;
+		boost::atomic<long>				m_lFramesDecoded;
+		boost::atomic<long>				m_lFramesDropped;
+		boost::atomic<long>				m_lFramesPresented;
+		TimingCounter					m_Demux;
+		TimingCounter					m_VideoDecode;
+		TimingCounter					m_AudioDecode;
+		TimingCounter					m_Scale;
+		TimingCounter					m_Copy;
+	};
+};
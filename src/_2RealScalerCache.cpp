@@ -0,0 +1,191 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This wrapper uses FFmpeg, and is licensed and credited as follows:
+
+	 * copyright (c) 2001 Fabrice Bellard
+	 *
+	 * This  FFmpeg.
+	 *
+	 * FFmpeg is free software; you can redistribute it and/or
+	 * modify it under the terms of the GNU Lesser General Public
+	 * License as published by the Free Software Foundation; either
+	 * version 2.1 of the License, or (at your option) any later version.
+	 *
+	 * FFmpeg is distributed in the hope that it will be useful,
+	 * but WITHOUT ANY WARRANTY; without even the implied warranty of
+	 * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	 * Lesser General Public License for more details.
+	 *
+	 * You should have received a copy of the GNU Lesser General Public
+	 * License along with FFmpeg; if not, write to the Free Software
+	 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA	 
+*/
+
+#include "_2RealScalerCache.h"
+#include "_2RealFramePool.h"
+
+// ffmpeg includes
+extern "C" {
+	#define __STDC_CONSTANT_MACROS
+	#include "stdint.h"
+	#include "libavcodec/avcodec.h"
+	#include "libswscale/swscale.h"
+}
+
+namespace _2RealFFmpegWrapper
+{
+
+ScalerCache::ScalerCache(int iMaxEntries, int iFramesPerPool, int iMaxFramesPerPool, boost::int64_t lExtraBytesPerPool) : m_iMaxEntries(iMaxEntries), m_iFramesPerPool(iFramesPerPool), m_iMaxFramesPerPool(iMaxFramesPerPool), m_lExtraBytesPerPool(lExtraBytesPerPool), m_lUseCounter(0), m_bAborted(false)
+{
+}
+
+ScalerCache::~ScalerCache()
+{
+	clear();
+}
+
+bool ScalerCache::select(int iSrcWidth, int iSrcHeight, int iSrcFormat, int iDstWidth, int iDstHeight, int iDstFormat, int iFlags, int iRowAlignment,
+						 SwsContext*& pContext, PixelConverter::Function& pConvert, FramePool*& pPool)
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_lUseCounter++;
+
+	for(unsigned int i=0; i<m_Entries.size(); i++)
+	{
+		Entry& entry = m_Entries[i];
+		if(entry.m_iSrcWidth == iSrcWidth && entry.m_iSrcHeight == iSrcHeight && entry.m_iSrcFormat == iSrcFormat &&
+		   entry.m_iDstWidth == iDstWidth && entry.m_iDstHeight == iDstHeight && entry.m_iDstFormat == iDstFormat && entry.m_iFlags == iFlags && entry.m_iRowAlignment == iRowAlignment)
+		{
+			entry.m_lLastUse = m_lUseCounter;
+			pContext = entry.m_pContext;
+			pConvert = entry.m_pConvert;
+			pPool = entry.m_pPool;
+			return true;
+		}
+	}
+
+	Entry entry;
+	entry.m_iSrcWidth = iSrcWidth;
+	entry.m_iSrcHeight = iSrcHeight;
+	entry.m_iSrcFormat = iSrcFormat;
+	entry.m_iDstWidth = iDstWidth;
+	entry.m_iDstHeight = iDstHeight;
+	entry.m_iDstFormat = iDstFormat;
+	entry.m_iFlags = iFlags;
+	entry.m_iRowAlignment = iRowAlignment;
+	entry.m_pContext = nullptr;
+	entry.m_pConvert = nullptr;
+	entry.m_lLastUse = m_lUseCounter;
+
+	// just the format changes, most likely to a 4 byte one for texture uploads, which the own kernels do faster
+	if(iSrcFormat != iDstFormat && iSrcWidth == iDstWidth && iSrcHeight == iDstHeight)
+		entry.m_pConvert = PixelConverter::find(iSrcFormat, iDstFormat);
+	if(entry.m_pConvert == nullptr && (iSrcFormat != iDstFormat || iSrcWidth != iDstWidth || iSrcHeight != iDstHeight))
+	{
+		entry.m_pContext = sws_getContext(iSrcWidth, iSrcHeight, (PixelFormat)iSrcFormat, iDstWidth, iDstHeight, (PixelFormat)iDstFormat, iFlags, NULL, NULL, NULL);
+		if(entry.m_pContext == nullptr)
+			return false;
+	}
+
+	int iMaxFrames = m_iMaxFramesPerPool;
+	int iBufferSize = avpicture_get_size((PixelFormat)iDstFormat, iDstWidth, iDstHeight);
+	if(m_lExtraBytesPerPool > 0 && iBufferSize > 0)
+		iMaxFrames += (int)(m_lExtraBytesPerPool / iBufferSize) + 1;
+
+	entry.m_pPool = new FramePool();
+	if(!entry.m_pPool->allocate(m_iFramesPerPool, iMaxFrames, iDstWidth, iDstHeight, iDstFormat, iRowAlignment))
+	{
+		freeEntry(entry);
+		return false;
+	}
+	if(m_bAborted)
+		entry.m_pPool->abort();
+
+	// evict the least recently used one, frames of it which are still queued or held stay valid until released
+	if((int)m_Entries.size() >= m_iMaxEntries)
+	{
+		unsigned int iOldest = 0;
+		for(unsigned int i=1; i<m_Entries.size(); i++)
+		{
+			if(m_Entries[i].m_lLastUse < m_Entries[iOldest].m_lLastUse)
+				iOldest = i;
+		}
+		freeEntry(m_Entries[iOldest]);
+		m_Entries.erase(m_Entries.begin() + iOldest);
+	}
+
+	m_Entries.push_back(entry);
+	pContext = entry.m_pContext;
+	pConvert = entry.m_pConvert;
+	pPool = entry.m_pPool;
+	return true;
+}
+
+void ScalerCache::freeEntry(Entry& entry)
+{
+	if(entry.m_pContext != nullptr)
+	{
+		sws_freeContext(entry.m_pContext);
+		entry.m_pContext = nullptr;
+	}
+	if(entry.m_pPool != nullptr)
+	{
+		entry.m_pPool->shutdown();
+		entry.m_pPool = nullptr;
+	}
+}
+
+void ScalerCache::abort()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_bAborted = true;
+	for(unsigned int i=0; i<m_Entries.size(); i++)
+		m_Entries[i].m_pPool->abort();
+}
+
+void ScalerCache::reset()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_bAborted = false;
+	for(unsigned int i=0; i<m_Entries.size(); i++)
+		m_Entries[i].m_pPool->reset();
+}
+
+void ScalerCache::clear()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	for(unsigned int i=0; i<m_Entries.size(); i++)
+		freeEntry(m_Entries[i]);
+	m_Entries.clear();
+}
+
+int ScalerCache::getEntryCount()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return (int)m_Entries.size();
+}
+
+};
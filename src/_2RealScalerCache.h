@@ -0,0 +1,87 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+*/
+
+#pragma once
+
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+#include "_2RealPixelConverter.h"
+
+struct SwsContext;
+
+namespace _2RealFFmpegWrapper
+{
+	class FramePool;
+
+	// conversion contexts and frame pools of the output formats a player was asked for, keyed by source and output
+	// format/size and scaling flags, so switching back and forth between e.g. preview and full size doesn't allocate anything
+	// after the first switch, the least recently used entry is evicted when more than iMaxEntries are in use
+	// pools may grow by lExtraBytesPerPool on top of iMaxFramesPerPool, for frames kept in a FrameCache
+	class ScalerCache
+	{
+	public:
+		ScalerCache(int iMaxEntries, int iFramesPerPool, int iMaxFramesPerPool, boost::int64_t lExtraBytesPerPool = 0);
+		~ScalerCache();
+
+		// pConvert is set if one of the PixelConverter kernels does the conversion, pContext is nullptr then, both are nullptr
+		// if the output equals the source and the planes just have to be copied, false if the output isn't supported
+		bool			select(int iSrcWidth, int iSrcHeight, int iSrcFormat, int iDstWidth, int iDstHeight, int iDstFormat, int iFlags, int iRowAlignment,
+							SwsContext*& pContext, PixelConverter::Function& pConvert, FramePool*& pPool);
+		void			abort();		// wakes up a thread waiting for a frame of one of the pools
+		void			reset();
+		void			clear();
+		int				getEntryCount();
+
+	private:
+		struct Entry
+		{
+			int				m_iSrcWidth;
+			int				m_iSrcHeight;
+			int				m_iSrcFormat;
+			int				m_iDstWidth;
+			int				m_iDstHeight;
+			int				m_iDstFormat;
+			int				m_iFlags;
+			int				m_iRowAlignment;
+			SwsContext*		m_pContext;
+			PixelConverter::Function	m_pConvert;
+			FramePool*		m_pPool;
+			unsigned long	m_lLastUse;
+		};
+
+		void			freeEntry(Entry& entry);
+
+		std::vector<Entry>	m_Entries;
+		boost::mutex		m_Mutex;
+		int					m_iMaxEntries;
+		int					m_iFramesPerPool;
+		int					m_iMaxFramesPerPool;
+		boost::int64_t		m_lExtraBytesPerPool;
+		unsigned long		m_lUseCounter;
+		bool				m_bAborted;
+	};
+};
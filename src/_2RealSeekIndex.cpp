@@ -0,0 +1,446 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This wrapper uses FFmpeg, and is licensed and credited as follows:
+
+	 * copyright (c) 2001 Fabrice Bellard
+	 *
+	 * This  FFmpeg.
+	 *
+	 * FFmpeg is free software; you can redistribute it and/or
+	 * modify it under the terms of the GNU Lesser General Public
+	 * License as published by the Free Software Foundation; either
+	 * version 2.1 of the License, or (at your option) any later version.
+	 *
+	 * FFmpeg is distributed in the hope that it will be useful,
+	 * but WITHOUT ANY WARRANTY; without even the implied warranty of
+	 * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	 * Lesser General Public License for more details.
+	 *
+	 * You should have received a copy of the GNU Lesser General Public
+	 * License along with FFmpeg; if not, write to the Free Software
+	 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA	 
+*/
+
+#include "_2RealSeekIndex.h"
+#include "_2RealMappedFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <boost/filesystem.hpp>
+
+// ffmpeg includes
+extern "C" {
+	#define __STDC_CONSTANT_MACROS
+	#include "stdint.h"
+	#include "libavcodec/avcodec.h"
+	#include "libavformat/avformat.h"
+}
+
+namespace _2RealFFmpegWrapper
+{
+
+// cache file layout, all values in native byte order: magic, version, media file path, size, modification time,
+// fps the frame numbers were calculated with, duration, max frame number, entry count, entries
+static const char			s_CacheMagic[4] = {'2', 'R', 'S', 'I'};
+static const boost::uint32_t	s_iCacheVersion = 1;
+static const long				s_iEntrySize = 3 * sizeof(boost::int64_t) + sizeof(boost::int32_t) + 1;	// pts, dts, pos, frame number, key frame flag
+
+static const int64_t			s_lNoPts = (int64_t)AV_NOPTS_VALUE;		// signed, AV_NOPTS_VALUE itself is an unsigned constant
+
+template <typename T>
+static bool writeValue(FILE* pFile, const T& value)
+{
+	return fwrite(&value, sizeof(T), 1, pFile) == 1;
+}
+
+template <typename T>
+static bool readValue(FILE* pFile, T& value)
+{
+	return fread(&value, sizeof(T), 1, pFile) == 1;
+}
+
+// bytes between the read position and the end of the file, -1 if the file can't seek
+static long getRemainingBytes(FILE* pFile)
+{
+	long lPosition = ftell(pFile);
+	if(lPosition < 0 || fseek(pFile, 0, SEEK_END) != 0)
+		return -1;
+	long lEnd = ftell(pFile);
+	if(lEnd < lPosition || fseek(pFile, lPosition, SEEK_SET) != 0)
+		return -1;
+	return lEnd - lPosition;
+}
+
+SeekIndex::SeekIndex() : m_pMappedFile(nullptr), m_lFileSize(0), m_lFileTime(0), m_dDurationInMs(0), m_lMaxFrameNumber(-1), m_bComplete(false), m_bAbort(false)
+{
+}
+
+SeekIndex::~SeekIndex()
+{
+	abort();
+}
+
+bool SeekIndex::startBuilding(const std::string& strFileName, int iStream, double dFps, const std::string& strCacheDirectory, MappedFile* pMappedFile)
+{
+	if(iStream < 0 || dFps <= 0 || m_Thread.joinable())
+		return false;
+
+	if(!strCacheDirectory.empty() && identifyFile(strFileName))
+	{
+		// fnv-1a of the path as file name, the path itself is stored in the file and compared on load
+		boost::uint64_t lHash = 14695981039346656037ULL;
+		for(size_t i=0; i<m_strFileName.size(); i++)
+		{
+			lHash ^= (unsigned char)m_strFileName[i];
+			lHash *= 1099511628211ULL;
+		}
+		char strName[32];
+		sprintf(strName, "%016llx.idx", (unsigned long long)lHash);
+		m_strCacheFile = (boost::filesystem::path(strCacheDirectory) / strName).string();
+		if(load(dFps))
+			return true;
+	}
+
+	m_pMappedFile = pMappedFile;
+	m_Thread = boost::thread(&SeekIndex::threadedBuild, this, strFileName, iStream, dFps);
+	return true;
+}
+
+void SeekIndex::abort()
+{
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		m_bAbort = true;
+	}
+	if(m_Thread.joinable())
+		m_Thread.join();
+}
+
+void SeekIndex::addPacket(boost::int64_t lPts, boost::int64_t lDts, boost::int64_t lPos, long lFrameNumber, bool bKeyFrame)
+{
+	IndexEntry entry;
+	entry.m_lPts = lPts;
+	entry.m_lDts = lDts;
+	entry.m_lPos = lPos;
+	entry.m_lFrameNumber = lFrameNumber;
+	entry.m_bKeyFrame = bKeyFrame;
+
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_Entries.push_back(entry);
+	if(lFrameNumber > m_lMaxFrameNumber)
+		m_lMaxFrameNumber = lFrameNumber;
+	if(!bKeyFrame || lFrameNumber < 0)
+		return;
+
+	// keyframes nearly always come in presentation order, so this appends
+	std::vector<int>::iterator it = m_KeyFrames.end();
+	while(it != m_KeyFrames.begin() && m_Entries[*(it-1)].m_lFrameNumber > lFrameNumber)
+		--it;
+	m_KeyFrames.insert(it, (int)m_Entries.size() - 1);
+}
+
+void SeekIndex::buildKeyFrames()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_KeyFrames.clear();
+	m_lMaxFrameNumber = -1;
+	for(int i=0; i<(int)m_Entries.size(); i++)
+	{
+		if(m_Entries[i].m_lFrameNumber > m_lMaxFrameNumber)
+			m_lMaxFrameNumber = m_Entries[i].m_lFrameNumber;
+		if(m_Entries[i].m_bKeyFrame && m_Entries[i].m_lFrameNumber >= 0)
+			m_KeyFrames.push_back(i);
+	}
+	// insertion sort, as they are nearly always in order already
+	for(size_t i=1; i<m_KeyFrames.size(); i++)
+	{
+		int iEntry = m_KeyFrames[i];
+		size_t j = i;
+		while(j > 0 && m_Entries[m_KeyFrames[j-1]].m_lFrameNumber > m_Entries[iEntry].m_lFrameNumber)
+		{
+			m_KeyFrames[j] = m_KeyFrames[j-1];
+			j--;
+		}
+		m_KeyFrames[j] = iEntry;
+	}
+}
+
+void SeekIndex::finish()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	m_bComplete = true;
+}
+
+bool SeekIndex::findKeyFrame(long lTargetFrame, IndexEntry& entry)
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	if(lTargetFrame < 0 || m_KeyFrames.empty())
+		return false;
+
+	// while building, the keyframe in front of the target is only known for sure once a later one was indexed
+	if(!m_bComplete && m_Entries[m_KeyFrames.back()].m_lFrameNumber <= lTargetFrame)
+		return false;
+
+	// binary search for the last keyframe at or in front of the target, no table by frame number, as the frame
+	// numbers come from timestamps and a bogus one mustn't decide how much memory is taken
+	int iLow = 0, iHigh = (int)m_KeyFrames.size();
+	while(iLow < iHigh)
+	{
+		int iMid = (iLow + iHigh) / 2;
+		if(m_Entries[m_KeyFrames[iMid]].m_lFrameNumber <= lTargetFrame)
+			iLow = iMid + 1;
+		else
+			iHigh = iMid;
+	}
+	int iKey = iLow - 1;
+	if(iKey < 0)
+		iKey = 0;		// target in front of the first keyframe, e.g. leading b-frames
+	entry = m_Entries[m_KeyFrames[iKey]];
+	return true;
+}
+
+bool SeekIndex::isComplete()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return m_bComplete;
+}
+
+int SeekIndex::getEntryCount()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return (int)m_Entries.size();
+}
+
+long SeekIndex::getFrameCount()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return m_lMaxFrameNumber + 1;
+}
+
+double SeekIndex::getDurationInMs()
+{
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	return m_dDurationInMs;
+}
+
+bool SeekIndex::identifyFile(const std::string& strFileName)
+{
+	boost::system::error_code error;
+	boost::filesystem::path path = boost::filesystem::system_complete(strFileName, error);
+	if(error)
+		return false;
+	m_lFileSize = boost::filesystem::file_size(path, error);
+	if(error)
+		return false;
+	m_lFileTime = boost::filesystem::last_write_time(path, error);
+	if(error)
+		return false;
+	m_strFileName = path.string();
+	return true;
+}
+
+bool SeekIndex::load(double dFps)
+{
+	FILE* pFile = fopen(m_strCacheFile.c_str(), "rb");
+	if(pFile == nullptr)
+		return false;
+
+	char magic[4];
+	boost::uint32_t iVersion = 0, iLength = 0, iCount = 0;
+	boost::uint64_t lFileSize = 0;
+	boost::int64_t lFileTime = 0;
+	boost::int32_t iMaxFrameNumber = 0;
+	double dCachedFps = 0, dDuration = 0;
+	bool bValid = fread(magic, 1, 4, pFile) == 4 && memcmp(magic, s_CacheMagic, 4) == 0
+		&& readValue(pFile, iVersion) && iVersion == s_iCacheVersion
+		&& readValue(pFile, iLength) && iLength == m_strFileName.size();
+	if(bValid)
+	{
+		std::string strPath(iLength, ' ');
+		bValid = (iLength == 0 || fread(&strPath[0], 1, iLength, pFile) == iLength) && strPath == m_strFileName
+			&& readValue(pFile, lFileSize) && lFileSize == m_lFileSize
+			&& readValue(pFile, lFileTime) && lFileTime == m_lFileTime
+			&& readValue(pFile, dCachedFps) && dCachedFps == dFps
+			&& readValue(pFile, dDuration) && readValue(pFile, iMaxFrameNumber) && readValue(pFile, iCount);
+	}
+	if(bValid)
+	{
+		// a broken count must not allocate gigabytes, the entries have to fit into what is left of the file
+		long lRemaining = getRemainingBytes(pFile);
+		bValid = lRemaining >= 0 && iCount <= (boost::uint64_t)lRemaining / s_iEntrySize;
+	}
+
+	std::vector<IndexEntry> entries;
+	if(bValid)
+	{
+		entries.resize(iCount);
+		for(boost::uint32_t i=0; bValid && i<iCount; i++)
+		{
+			boost::int32_t iFrameNumber = 0;
+			unsigned char cKeyFrame = 0;
+			bValid = readValue(pFile, entries[i].m_lPts) && readValue(pFile, entries[i].m_lDts) && readValue(pFile, entries[i].m_lPos)
+				&& readValue(pFile, iFrameNumber) && readValue(pFile, cKeyFrame);
+			entries[i].m_lFrameNumber = iFrameNumber;
+			entries[i].m_bKeyFrame = cKeyFrame != 0;
+		}
+	}
+	fclose(pFile);
+	if(!bValid)
+		return false;		// outdated or broken, is rebuilt and overwritten
+
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		m_Entries.swap(entries);
+		m_dDurationInMs = dDuration;
+	}
+	buildKeyFrames();
+	finish();
+	return true;
+}
+
+bool SeekIndex::save(double dFps)
+{
+	boost::system::error_code error;
+	boost::filesystem::create_directories(boost::filesystem::path(m_strCacheFile).parent_path(), error);
+
+	// written to a temporary file first, so another player never loads a half written index
+	std::string strTempFile = m_strCacheFile + ".tmp";
+	FILE* pFile = fopen(strTempFile.c_str(), "wb");
+	if(pFile == nullptr)
+		return false;
+
+	boost::mutex::scoped_lock scopedLock(m_Mutex);
+	boost::uint32_t iLength = (boost::uint32_t)m_strFileName.size();
+	bool bValid = fwrite(s_CacheMagic, 1, 4, pFile) == 4
+		&& writeValue(pFile, s_iCacheVersion)
+		&& writeValue(pFile, iLength) && fwrite(m_strFileName.c_str(), 1, iLength, pFile) == iLength
+		&& writeValue(pFile, m_lFileSize) && writeValue(pFile, m_lFileTime)
+		&& writeValue(pFile, dFps) && writeValue(pFile, m_dDurationInMs)
+		&& writeValue(pFile, (boost::int32_t)m_lMaxFrameNumber)
+		&& writeValue(pFile, (boost::uint32_t)m_Entries.size());
+	for(size_t i=0; bValid && i<m_Entries.size(); i++)
+	{
+		const IndexEntry& entry = m_Entries[i];
+		bValid = writeValue(pFile, entry.m_lPts) && writeValue(pFile, entry.m_lDts) && writeValue(pFile, entry.m_lPos)
+			&& writeValue(pFile, (boost::int32_t)entry.m_lFrameNumber) && writeValue(pFile, (unsigned char)(entry.m_bKeyFrame ? 1 : 0));
+	}
+	bValid = (fclose(pFile) == 0) && bValid;
+	if(bValid)
+	{
+		boost::filesystem::remove(m_strCacheFile, error);
+		boost::filesystem::rename(strTempFile, m_strCacheFile, error);
+		bValid = !error;
+	}
+	if(!bValid)
+		boost::filesystem::remove(strTempFile, error);
+	return bValid;
+}
+
+// reads all packets of the file without decoding them, other streams are discarded by the demuxer where possible
+void SeekIndex::threadedBuild(std::string strFileName, int iStream, double dFps)
+{
+	// a reader of its own on the player's mapping, the position is independent of the player's demuxer
+	AVFormatContext* pFormatContext = nullptr;
+	AVIOContext* pIOContext = (m_pMappedFile != nullptr) ? m_pMappedFile->createIOContext() : nullptr;
+	if(pIOContext != nullptr)
+	{
+		pFormatContext = avformat_alloc_context();
+		pFormatContext->pb = pIOContext;
+	}
+	if(avformat_open_input(&pFormatContext, strFileName.c_str(), NULL, NULL) != 0)
+	{
+		MappedFile::freeIOContext(pIOContext);
+		return;
+	}
+	if(pFormatContext->nb_streams <= (unsigned int)iStream && avformat_find_stream_info(pFormatContext, NULL) < 0)
+	{
+		avformat_close_input(&pFormatContext);
+		MappedFile::freeIOContext(pIOContext);
+		return;
+	}
+	if(pFormatContext->nb_streams <= (unsigned int)iStream)
+	{
+		avformat_close_input(&pFormatContext);
+		MappedFile::freeIOContext(pIOContext);
+		return;
+	}
+
+	for(unsigned int i=0; i<pFormatContext->nb_streams; i++)
+	{
+		if(i != (unsigned int)iStream)
+			pFormatContext->streams[i]->discard = AVDISCARD_ALL;
+	}
+	AVStream* pStream = pFormatContext->streams[iStream];
+	double dTimeBase = (double)pStream->time_base.num / (double)pStream->time_base.den;
+
+	AVPacket packet;
+	bool bIsAborted = false;
+	int64_t lEndTimestamp = s_lNoPts;		// end of the last packet in presentation order
+	while(av_read_frame(pFormatContext, &packet) >= 0)
+	{
+		if(packet.stream_index == iStream)
+		{
+			if(packet.pts != s_lNoPts && (lEndTimestamp == s_lNoPts || packet.pts + packet.duration > lEndTimestamp))
+				lEndTimestamp = packet.pts + packet.duration;
+
+			// same frame numbering as the player uses
+			int64_t lTimestamp = (packet.pts != s_lNoPts) ? packet.pts : packet.dts;
+			long lFrameNumber = -1;
+			if(lTimestamp != s_lNoPts)
+			{
+				if(pStream->start_time != s_lNoPts)
+					lTimestamp -= pStream->start_time;
+				lFrameNumber = (long)floor(lTimestamp * dTimeBase * dFps + 0.5);
+			}
+			addPacket(packet.pts, packet.dts, packet.pos, lFrameNumber, (packet.flags & AV_PKT_FLAG_KEY) != 0);
+		}
+		av_free_packet(&packet);
+
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		if(m_bAbort)
+		{
+			bIsAborted = true;
+			break;
+		}
+	}
+	int64_t lStartTime = (pStream->start_time != s_lNoPts) ? pStream->start_time : 0;
+	avformat_close_input(&pFormatContext);
+	MappedFile::freeIOContext(pIOContext);
+	if(bIsAborted)
+		return;
+
+	{
+		boost::mutex::scoped_lock scopedLock(m_Mutex);
+		if(lEndTimestamp != s_lNoPts)
+			m_dDurationInMs = (lEndTimestamp - lStartTime) * dTimeBase * 1000.0;
+	}
+	finish();
+	if(!m_strCacheFile.empty())
+		save(dFps);
+}
+
+};
@@ -0,0 +1,89 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/thread.hpp>
+
+namespace _2RealFFmpegWrapper
+{
+	class MappedFile;
+
+	// one video packet of the file as the demuxer returned it
+	struct IndexEntry
+	{
+		boost::int64_t		m_lPts;
+		boost::int64_t		m_lDts;
+		boost::int64_t		m_lPos;				// byte position in the file, -1 if the demuxer doesn't know it
+		long				m_lFrameNumber;		// presentation frame number calculated from pts (dts if pts is missing)
+		bool				m_bKeyFrame;
+	};
+
+	// packet index of the video stream, built on its own thread with a separate demuxer so the player isn't slowed down,
+	// it tells which keyframe to seek to for a given frame so the decoder can decode forward to exactly that frame
+	// with a cache directory the finished index is stored there and loaded instead of scanning the file again, the cache
+	// file is keyed by path, size and modification time of the media file
+	class SeekIndex
+	{
+	public:
+		SeekIndex();
+		~SeekIndex();
+
+		bool			startBuilding(const std::string& strFileName, int iStream, double dFps, const std::string& strCacheDirectory = "", MappedFile* pMappedFile = nullptr);	// the mapping has to outlive the index thread
+		void			abort();					// stops building and waits for the index thread
+		void			addPacket(boost::int64_t lPts, boost::int64_t lDts, boost::int64_t lPos, long lFrameNumber, bool bKeyFrame);
+		void			finish();					// marks the index as covering the whole stream
+		bool			findKeyFrame(long lTargetFrame, IndexEntry& entry);	// false if the index doesn't cover the target yet
+		bool			isComplete();
+		int				getEntryCount();
+		long			getFrameCount();			// number of frames seen so far
+		double			getDurationInMs();			// end of the last packet, valid when complete
+
+	private:
+		void			threadedBuild(std::string strFileName, int iStream, double dFps);
+		bool			identifyFile(const std::string& strFileName);
+		bool			load(double dFps);
+		bool			save(double dFps);
+		void			buildKeyFrames();
+
+		std::vector<IndexEntry>		m_Entries;			// in file order
+		std::vector<int>			m_KeyFrames;		// entry indices of the keyframes sorted by frame number
+		boost::thread				m_Thread;
+		boost::mutex				m_Mutex;
+		std::string					m_strFileName;
+		std::string					m_strCacheFile;		// empty if not cached
+		MappedFile*					m_pMappedFile;		// read instead of the file if set
+		boost::uint64_t				m_lFileSize;
+		boost::int64_t				m_lFileTime;
+		double						m_dDurationInMs;
+		long						m_lMaxFrameNumber;
+		bool						m_bComplete;
+		bool						m_bAbort;
+	};
+};
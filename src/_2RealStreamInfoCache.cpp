@@ -0,0 +1,337 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+	 
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+
+	This wrapper uses FFmpeg, and is licensed and credited as follows:
+
+	 * copyright (c) 2001 Fabrice Bellard
+	 *
+	 * This  FFmpeg.
+	 *
+	 * FFmpeg is free software; you can redistribute it and/or
+	 * modify it under the terms of the GNU Lesser General Public
+	 * License as published by the Free Software Foundation; either
+	 * version 2.1 of the License, or (at your option) any later version.
+	 *
+	 * FFmpeg is distributed in the hope that it will be useful,
+	 * but WITHOUT ANY WARRANTY; without even the implied warranty of
+	 * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+	 * Lesser General Public License for more details.
+	 *
+	 * You should have received a copy of the GNU Lesser General Public
+	 * License along with FFmpeg; if not, write to the Free Software
+	 * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA	 
+*/
+
+#include "_2RealStreamInfoCache.h"
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <vector>
+#include <boost/cstdint.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+// ffmpeg includes
+extern "C" {
+	#define __STDC_CONSTANT_MACROS
+	#include "stdint.h"
+	#include "libavcodec/avcodec.h"
+	#include "libavformat/avformat.h"
+}
+
+namespace _2RealFFmpegWrapper
+{
+
+// what the analysis fills in beyond the container header, 64 bit values first so the layout has no padding
+struct CachedStream
+{
+	boost::int64_t		m_lChannelLayout;
+	boost::int64_t		m_lStartTime;
+	boost::int64_t		m_lDuration;
+	boost::int64_t		m_lFrames;
+	boost::int32_t		m_iCodecType;
+	boost::int32_t		m_iCodecId;
+	boost::int32_t		m_iExtradataSize;		// just compared, the extradata itself comes from the header
+	boost::int32_t		m_iWidth;
+	boost::int32_t		m_iHeight;
+	boost::int32_t		m_iPixelFormat;
+	boost::int32_t		m_iHasBFrames;
+	boost::int32_t		m_iSampleRate;
+	boost::int32_t		m_iChannels;
+	boost::int32_t		m_iSampleFormat;
+	boost::int32_t		m_iBitrate;
+	boost::int32_t		m_iTicksPerFrame;
+	boost::int32_t		m_iCodecTimeBase[2];
+	boost::int32_t		m_iAspectRatio[2];
+	boost::int32_t		m_iRealFrameRate[2];
+	boost::int32_t		m_iAverageFrameRate[2];
+};
+
+struct CachedFile
+{
+	std::string					m_strPath;
+	boost::uint64_t				m_lFileSize;
+	boost::int64_t				m_lFileTime;
+	boost::int64_t				m_lStartTime;
+	boost::int64_t				m_lDuration;
+	boost::int32_t				m_iBitrate;
+	std::vector<CachedStream>	m_Streams;
+};
+
+// cache file layout, all values in native byte order: magic, version, size of CachedStream, media file path, size,
+// modification time, start time, duration, bitrate, stream count, streams
+static const char			s_CacheMagic[4] = {'2', 'R', 'S', 'N'};
+static const boost::uint32_t	s_iCacheVersion = 1;
+static const boost::uint32_t	s_iMaxStreams = 64;		// sanity limit for broken files
+
+static boost::mutex						s_Mutex;
+static std::map<std::string, CachedFile>	s_Files;		// by absolute path
+
+template <typename T>
+static bool writeValue(FILE* pFile, const T& value)
+{
+	return fwrite(&value, sizeof(T), 1, pFile) == 1;
+}
+
+template <typename T>
+static bool readValue(FILE* pFile, T& value)
+{
+	return fread(&value, sizeof(T), 1, pFile) == 1;
+}
+
+static AVRational makeRational(int iNum, int iDen)
+{
+	AVRational r = {iNum, iDen};
+	return r;
+}
+
+static bool identifyFile(const std::string& strFileName, CachedFile& file)
+{
+	boost::system::error_code error;
+	boost::filesystem::path path = boost::filesystem::system_complete(strFileName, error);
+	if(error)
+		return false;
+	file.m_lFileSize = boost::filesystem::file_size(path, error);
+	if(error)
+		return false;
+	file.m_lFileTime = boost::filesystem::last_write_time(path, error);
+	if(error)
+		return false;
+	file.m_strPath = path.string();
+	return true;
+}
+
+// same naming as the seek index cache, fnv-1a of the path
+static std::string getCacheFile(const std::string& strCacheDirectory, const std::string& strPath)
+{
+	boost::uint64_t lHash = 14695981039346656037ULL;
+	for(size_t i=0; i<strPath.size(); i++)
+	{
+		lHash ^= (unsigned char)strPath[i];
+		lHash *= 1099511628211ULL;
+	}
+	char strName[32];
+	sprintf(strName, "%016llx.nfo", (unsigned long long)lHash);
+	return (boost::filesystem::path(strCacheDirectory) / strName).string();
+}
+
+static bool loadFile(const std::string& strCacheFile, CachedFile& file)
+{
+	FILE* pFile = fopen(strCacheFile.c_str(), "rb");
+	if(pFile == nullptr)
+		return false;
+
+	char magic[4];
+	boost::uint32_t iVersion = 0, iStructSize = 0, iLength = 0, iCount = 0;
+	boost::uint64_t lFileSize = 0;
+	boost::int64_t lFileTime = 0;
+	bool bValid = fread(magic, 1, 4, pFile) == 4 && memcmp(magic, s_CacheMagic, 4) == 0
+		&& readValue(pFile, iVersion) && iVersion == s_iCacheVersion
+		&& readValue(pFile, iStructSize) && iStructSize == sizeof(CachedStream)
+		&& readValue(pFile, iLength) && iLength == file.m_strPath.size();
+	if(bValid)
+	{
+		std::string strPath(iLength, ' ');
+		bValid = (iLength == 0 || fread(&strPath[0], 1, iLength, pFile) == iLength) && strPath == file.m_strPath
+			&& readValue(pFile, lFileSize) && lFileSize == file.m_lFileSize
+			&& readValue(pFile, lFileTime) && lFileTime == file.m_lFileTime
+			&& readValue(pFile, file.m_lStartTime) && readValue(pFile, file.m_lDuration) && readValue(pFile, file.m_iBitrate)
+			&& readValue(pFile, iCount) && iCount <= s_iMaxStreams;
+	}
+	if(bValid)
+	{
+		file.m_Streams.resize(iCount);
+		bValid = iCount == 0 || fread(&file.m_Streams[0], sizeof(CachedStream), iCount, pFile) == iCount;
+	}
+	fclose(pFile);
+	return bValid;
+}
+
+static bool saveFile(const std::string& strCacheFile, const CachedFile& file)
+{
+	boost::system::error_code error;
+	boost::filesystem::create_directories(boost::filesystem::path(strCacheFile).parent_path(), error);
+
+	// written to a temporary file first, so another player never loads a half written file
+	std::string strTempFile = strCacheFile + ".tmp";
+	FILE* pFile = fopen(strTempFile.c_str(), "wb");
+	if(pFile == nullptr)
+		return false;
+
+	boost::uint32_t iLength = (boost::uint32_t)file.m_strPath.size();
+	boost::uint32_t iCount = (boost::uint32_t)file.m_Streams.size();
+	bool bValid = fwrite(s_CacheMagic, 1, 4, pFile) == 4
+		&& writeValue(pFile, s_iCacheVersion) && writeValue(pFile, (boost::uint32_t)sizeof(CachedStream))
+		&& writeValue(pFile, iLength) && fwrite(file.m_strPath.c_str(), 1, iLength, pFile) == iLength
+		&& writeValue(pFile, file.m_lFileSize) && writeValue(pFile, file.m_lFileTime)
+		&& writeValue(pFile, file.m_lStartTime) && writeValue(pFile, file.m_lDuration) && writeValue(pFile, file.m_iBitrate)
+		&& writeValue(pFile, iCount)
+		&& (iCount == 0 || fwrite(&file.m_Streams[0], sizeof(CachedStream), iCount, pFile) == iCount);
+	bValid = (fclose(pFile) == 0) && bValid;
+	if(bValid)
+	{
+		boost::filesystem::remove(strCacheFile, error);
+		boost::filesystem::rename(strTempFile, strCacheFile, error);
+		bValid = !error;
+	}
+	if(!bValid)
+		boost::filesystem::remove(strTempFile, error);
+	return bValid;
+}
+
+bool StreamInfoCache::apply(const std::string& strFileName, AVFormatContext* pFormatContext, const std::string& strCacheDirectory)
+{
+	CachedFile file;
+	if(!identifyFile(strFileName, file))
+		return false;
+
+	bool bFound = false;
+	{
+		boost::mutex::scoped_lock scopedLock(s_Mutex);
+		std::map<std::string, CachedFile>::iterator it = s_Files.find(file.m_strPath);
+		if(it != s_Files.end() && it->second.m_lFileSize == file.m_lFileSize && it->second.m_lFileTime == file.m_lFileTime)
+		{
+			file = it->second;
+			bFound = true;
+		}
+	}
+	if(!bFound && !strCacheDirectory.empty() && loadFile(getCacheFile(strCacheDirectory, file.m_strPath), file))
+	{
+		boost::mutex::scoped_lock scopedLock(s_Mutex);
+		s_Files[file.m_strPath] = file;
+		bFound = true;
+	}
+
+	// the header has to announce the same streams, otherwise (e.g. streams found while probing) the analysis runs
+	if(!bFound || file.m_Streams.size() != pFormatContext->nb_streams)
+		return false;
+	for(unsigned int i=0; i<pFormatContext->nb_streams; i++)
+	{
+		const CachedStream& stream = file.m_Streams[i];
+		AVCodecContext* pCodecContext = pFormatContext->streams[i]->codec;
+		if(stream.m_iCodecType != pCodecContext->codec_type || stream.m_iCodecId != pCodecContext->codec_id || stream.m_iExtradataSize != pCodecContext->extradata_size)
+			return false;
+	}
+
+	for(unsigned int i=0; i<pFormatContext->nb_streams; i++)
+	{
+		const CachedStream& stream = file.m_Streams[i];
+		AVStream* pStream = pFormatContext->streams[i];
+		AVCodecContext* pCodecContext = pStream->codec;
+		pCodecContext->width = stream.m_iWidth;
+		pCodecContext->height = stream.m_iHeight;
+		pCodecContext->pix_fmt = (PixelFormat)stream.m_iPixelFormat;
+		pCodecContext->has_b_frames = stream.m_iHasBFrames;
+		pCodecContext->sample_rate = stream.m_iSampleRate;
+		pCodecContext->channels = stream.m_iChannels;
+		pCodecContext->sample_fmt = (AVSampleFormat)stream.m_iSampleFormat;
+		pCodecContext->channel_layout = stream.m_lChannelLayout;
+		pCodecContext->bit_rate = stream.m_iBitrate;
+		pCodecContext->ticks_per_frame = stream.m_iTicksPerFrame;
+		pCodecContext->time_base = makeRational(stream.m_iCodecTimeBase[0], stream.m_iCodecTimeBase[1]);
+		pCodecContext->sample_aspect_ratio = makeRational(stream.m_iAspectRatio[0], stream.m_iAspectRatio[1]);
+		pStream->r_frame_rate = makeRational(stream.m_iRealFrameRate[0], stream.m_iRealFrameRate[1]);
+		pStream->avg_frame_rate = makeRational(stream.m_iAverageFrameRate[0], stream.m_iAverageFrameRate[1]);
+		pStream->start_time = stream.m_lStartTime;
+		pStream->duration = stream.m_lDuration;
+		pStream->nb_frames = stream.m_lFrames;
+	}
+	pFormatContext->start_time = file.m_lStartTime;
+	pFormatContext->duration = file.m_lDuration;
+	pFormatContext->bit_rate = file.m_iBitrate;
+	return true;
+}
+
+void StreamInfoCache::store(const std::string& strFileName, AVFormatContext* pFormatContext, const std::string& strCacheDirectory)
+{
+	CachedFile file;
+	if(!identifyFile(strFileName, file) || pFormatContext->nb_streams > s_iMaxStreams)
+		return;
+
+	file.m_lStartTime = pFormatContext->start_time;
+	file.m_lDuration = pFormatContext->duration;
+	file.m_iBitrate = pFormatContext->bit_rate;
+	file.m_Streams.resize(pFormatContext->nb_streams);
+	for(unsigned int i=0; i<pFormatContext->nb_streams; i++)
+	{
+		CachedStream& stream = file.m_Streams[i];
+		memset(&stream, 0, sizeof(CachedStream));
+		AVStream* pStream = pFormatContext->streams[i];
+		AVCodecContext* pCodecContext = pStream->codec;
+		stream.m_iCodecType = pCodecContext->codec_type;
+		stream.m_iCodecId = pCodecContext->codec_id;
+		stream.m_iExtradataSize = pCodecContext->extradata_size;
+		stream.m_iWidth = pCodecContext->width;
+		stream.m_iHeight = pCodecContext->height;
+		stream.m_iPixelFormat = pCodecContext->pix_fmt;
+		stream.m_iHasBFrames = pCodecContext->has_b_frames;
+		stream.m_iSampleRate = pCodecContext->sample_rate;
+		stream.m_iChannels = pCodecContext->channels;
+		stream.m_iSampleFormat = pCodecContext->sample_fmt;
+		stream.m_lChannelLayout = pCodecContext->channel_layout;
+		stream.m_iBitrate = pCodecContext->bit_rate;
+		stream.m_iTicksPerFrame = pCodecContext->ticks_per_frame;
+		stream.m_iCodecTimeBase[0] = pCodecContext->time_base.num;
+		stream.m_iCodecTimeBase[1] = pCodecContext->time_base.den;
+		stream.m_iAspectRatio[0] = pCodecContext->sample_aspect_ratio.num;
+		stream.m_iAspectRatio[1] = pCodecContext->sample_aspect_ratio.den;
+		stream.m_iRealFrameRate[0] = pStream->r_frame_rate.num;
+		stream.m_iRealFrameRate[1] = pStream->r_frame_rate.den;
+		stream.m_iAverageFrameRate[0] = pStream->avg_frame_rate.num;
+		stream.m_iAverageFrameRate[1] = pStream->avg_frame_rate.den;
+		stream.m_lStartTime = pStream->start_time;
+		stream.m_lDuration = pStream->duration;
+		stream.m_lFrames = pStream->nb_frames;
+	}
+
+	{
+		boost::mutex::scoped_lock scopedLock(s_Mutex);
+		s_Files[file.m_strPath] = file;
+	}
+	if(!strCacheDirectory.empty())
+		saveFile(getCacheFile(strCacheDirectory, file.m_strPath), file);
+}
+
+};
@@ -0,0 +1,44 @@
+/*
+	CADET - Center for Advances in Digital Entertainment Technologies
+	Copyright 2012 University of Applied Science Salzburg / MultiMediaTechnology
+
+	http://www.cadet.at
+	http://multimediatechnology.at/
+
+	Licensed under the Apache License, Version 2.0 (the "License");
+	you may not use this file except in compliance with the License.
+	You may obtain a copy of the License at
+
+	http://www.apache.org/licenses/LICENSE-2.0
+
+	Unless required by applicable law or agreed to in writing, software
+	distributed under the License is distributed on an "AS IS" BASIS,
+	WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+	See the License for the specific language governing permissions and
+	limitations under the License.
+
+	CADET - Center for Advances in Digital Entertainment Technologies
+
+	Authors: Robert Praxmarer
+	Web: http://www.1n0ut.com
+	Email: support@cadet.at
+*/
+
+#pragma once
+
+#include <string>
+
+struct AVFormatContext;
+
+namespace _2RealFFmpegWrapper
+{
+	// stream parameters avformat_find_stream_info found for a file, so opening the file again can skip that analysis
+	// kept for the process and, with a cache directory, on disk next to the seek indices, keyed by path, size and
+	// modification time like those
+	class StreamInfoCache
+	{
+	public:
+		static bool		apply(const std::string& strFileName, AVFormatContext* pFormatContext, const std::string& strCacheDirectory);	// false if the file is unknown or its streams differ from the cached ones
+		static void		store(const std::string& strFileName, AVFormatContext* pFormatContext, const std::string& strCacheDirectory);	// after a complete analysis
+	};
+};
@@ -30,8 +30,9 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #ifndef _MSC_VER // [
-#error "Use this header only with Microsoft Visual C++ compilers!"
-#endif // _MSC_VER ]
+// other compilers have their own, this one is just found first when included in quotes
+#include_next <inttypes.h>
+#else // ] [
 
 #ifndef _MSC_INTTYPES_H_ // [
 #define _MSC_INTTYPES_H_
@@ -303,3 +304,5 @@ imaxdiv_t __cdecl imaxdiv(intmax_t numer, intmax_t denom)
 
 
 #endif // _MSC_INTTYPES_H_ ]
+
+#endif // _MSC_VER ]